@@ -0,0 +1,85 @@
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// Monotonic wall-clock time in nanoseconds.
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/// Number of online cores, or 1 if that can't be determined.
+static inline long bench_num_cores(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? n : 1;
+}
+
+/// Keeps the compiler from optimizing away a value
+/// that is only produced for the benchmark.
+static inline void bench_consume(void *ptr) {
+    __asm__ volatile("" : : "r"(ptr) : "memory");
+}
+
+/// How `bench_report` prints results, picked by the BENCH_FORMAT
+/// environment variable: "text" (the default) for people, or
+/// "json" (one object per line) and "csv" for tracking results
+/// across releases.
+typedef enum {
+    BENCH_TEXT = 0,
+    BENCH_JSON = 1,
+    BENCH_CSV = 2,
+} bench_format_t;
+
+static inline bench_format_t bench_format(void) {
+    const char *format = getenv("BENCH_FORMAT");
+    if (format != NULL && strcmp(format, "json") == 0) return BENCH_JSON;
+    if (format != NULL && strcmp(format, "csv") == 0) return BENCH_CSV;
+    return BENCH_TEXT;
+}
+
+/// Prints one result: `ops` operations of case `name` of the
+/// benchmark `bench` took `ns` nanoseconds in total. `params`
+/// describes the run as space-separated key=value pairs, and
+/// must not contain quotes or commas.
+///
+/// CSV output starts with a header row, once per program,
+/// unless BENCH_CSV_HEADER is set to 0.
+static inline void bench_report(const char *bench, const char *name, const char *params,
+                                size_t ops, uint64_t ns) {
+    static int header_done = 0;
+    double ns_per_op = (ops > 0) ? (double)ns / (double)ops : 0.0;
+    double ops_per_s = (ns > 0) ? (double)ops * 1e9 / (double)ns : 0.0;
+
+    switch (bench_format()) {
+    case BENCH_JSON:
+        printf("{\"bench\":\"%s\",\"case\":\"%s\",\"params\":\"%s\","
+               "\"ops\":%zu,\"ns\":%llu,\"ns_per_op\":%.3f,\"ops_per_s\":%.1f}\n",
+               bench, name, params, ops, (unsigned long long)ns, ns_per_op, ops_per_s);
+        break;
+    case BENCH_CSV:
+        if (!header_done) {
+            const char *header = getenv("BENCH_CSV_HEADER");
+            if (header == NULL || strcmp(header, "0") != 0) {
+                printf("bench,case,params,ops,ns,ns_per_op,ops_per_s\n");
+            }
+            header_done = 1;
+        }
+        printf("%s,%s,%s,%zu,%llu,%.3f,%.1f\n",
+               bench, name, params, ops, (unsigned long long)ns, ns_per_op, ops_per_s);
+        break;
+    case BENCH_TEXT:
+        printf("%-16s %-14s %-34s %10.2f ns/op %12.0f ops/s\n",
+               bench, name, params, ns_per_op, ops_per_s);
+        break;
+    }
+    (void)fflush(stdout);
+}
+
+#endif // __BENCH_H
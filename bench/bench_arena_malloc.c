@@ -0,0 +1,174 @@
+#include "../include/arena.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Blocks allocated between two clears of the arena.
+#define BLOCKS_PER_ROUND 4096
+#define ROUNDS 256
+
+/// Scopes opened by the temp arena churn.
+#define TEMP_ROUNDS 1000000
+#define TEMP_DEPTH 3
+#define TEMP_ALLOCS 4
+
+static size_t sizes[BLOCKS_PER_ROUND];
+static void *blocks[BLOCKS_PER_ROUND];
+
+/// Fills `sizes` with a mix of request sizes: mostly small
+/// objects, some medium buffers and the odd page-sized one.
+static void init_sizes(void) {
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t r = state >> 33;
+        switch (r % 20) {
+        case 0:
+            sizes[i] = 1024 + (r >> 5) % 3073;
+            break;
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+            sizes[i] = 64 + (r >> 5) % 961;
+            break;
+        default:
+            sizes[i] = 8 + (r >> 5) % 57;
+            break;
+        }
+    }
+}
+
+/// Runs one untimed round on both allocators, so that neither
+/// pays for first-touch page faults inside the timing.
+static void warm_up(arena_t *arena) {
+    for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+        (void)memset(arena_alloc_nozero_in(arena, sizes[i]), 0, sizes[i]);
+        blocks[i] = malloc(sizes[i]);
+        (void)memset(blocks[i], 0, sizes[i]);
+    }
+    for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+        free(blocks[i]);
+    }
+    arena_clear_in(arena);
+}
+
+/// Allocates a round of mixed-size blocks, touches each one
+/// and releases them all at once with `arena_clear_in`.
+static void run_mixed_arena(arena_t *arena) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+            char *ptr = arena_alloc_nozero_in(arena, sizes[i]);
+            ptr[0] = (char)i;
+            bench_consume(ptr);
+        }
+        arena_clear_in(arena);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_report("arena_malloc", "mixed", "impl=arena", BLOCKS_PER_ROUND * ROUNDS, elapsed);
+}
+
+/// Same as `run_mixed_arena`, but with `malloc` and
+/// one `free` per block at the end of each round.
+static void run_mixed_malloc(void) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+            char *ptr = malloc(sizes[i]);
+            ptr[0] = (char)i;
+            blocks[i] = ptr;
+        }
+        for (size_t i = 0; i < BLOCKS_PER_ROUND; i++) {
+            free(blocks[i]);
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_report("arena_malloc", "mixed", "impl=malloc", BLOCKS_PER_ROUND * ROUNDS, elapsed);
+}
+
+/// Opens `depth` nested temp arenas, each holding a few
+/// scratch allocations, then unwinds them innermost first.
+static void temp_scope(arena_t *arena, size_t depth, size_t round) {
+    arena_temp_t *temp = arena_temp_new_in(arena);
+    for (size_t i = 0; i < TEMP_ALLOCS; i++) {
+        char *ptr = arena_temp_alloc_nozero(temp, sizes[(round + i) % BLOCKS_PER_ROUND]);
+        ptr[0] = (char)i;
+        bench_consume(ptr);
+    }
+    if (depth > 1) {
+        temp_scope(arena, depth - 1, round + TEMP_ALLOCS);
+    }
+    arena_temp_delete(temp);
+}
+
+static void run_temp_arena(arena_t *arena) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < TEMP_ROUNDS; r++) {
+        temp_scope(arena, TEMP_DEPTH, r);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char params[32];
+    (void)snprintf(params, sizeof(params), "impl=arena depth=%d", TEMP_DEPTH);
+    bench_report("arena_malloc", "temp_scope", params, TEMP_ROUNDS * TEMP_DEPTH, elapsed);
+}
+
+/// Opens and closes an empty temp arena, which is the fixed
+/// cost that every scratch scope pays on top of its allocations.
+static void run_temp_empty(arena_t *arena) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < TEMP_ROUNDS; r++) {
+        arena_temp_t *temp = arena_temp_new_in(arena);
+        bench_consume(temp);
+        arena_temp_delete(temp);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_report("arena_malloc", "temp_empty", "impl=arena", TEMP_ROUNDS, elapsed);
+}
+
+/// Same scratch allocations as `temp_scope`, freed one by one.
+static void malloc_scope(size_t depth, size_t round) {
+    void *ptrs[TEMP_ALLOCS];
+    for (size_t i = 0; i < TEMP_ALLOCS; i++) {
+        char *ptr = malloc(sizes[(round + i) % BLOCKS_PER_ROUND]);
+        ptr[0] = (char)i;
+        ptrs[i] = ptr;
+    }
+    if (depth > 1) {
+        malloc_scope(depth - 1, round + TEMP_ALLOCS);
+    }
+    for (size_t i = 0; i < TEMP_ALLOCS; i++) {
+        free(ptrs[i]);
+    }
+}
+
+static void run_temp_malloc(void) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < TEMP_ROUNDS; r++) {
+        malloc_scope(TEMP_DEPTH, r);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char params[32];
+    (void)snprintf(params, sizeof(params), "impl=malloc depth=%d", TEMP_DEPTH);
+    bench_report("arena_malloc", "temp_scope", params, TEMP_ROUNDS * TEMP_DEPTH, elapsed);
+}
+
+int main(void) {
+    init_sizes();
+    arena_t *arena = arena_new();
+    arena_set_retention_in(arena, ARENA_RETAIN_ALL, 0);
+
+    warm_up(arena);
+    run_mixed_arena(arena);
+    run_mixed_malloc();
+    run_temp_empty(arena);
+    run_temp_arena(arena);
+    run_temp_malloc();
+
+    arena_destroy(arena);
+    return EXIT_SUCCESS;
+}
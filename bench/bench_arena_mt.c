@@ -0,0 +1,98 @@
+#include "../include/arena.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ALLOCS_PER_THREAD 10000000
+#define ALLOCS_PER_CLEAR 32
+
+static pthread_barrier_t start_line;
+
+/// Hammers the calling thread's implicit arena with small
+/// allocations, clearing it every `ALLOCS_PER_CLEAR` allocations
+/// so that the working set stays small and hot.
+static void *arena_worker(void *_unused) {
+    (void)_unused;
+    (void)arena_alloc(1);
+    arena_clear();
+
+    pthread_barrier_wait(&start_line);
+    for (size_t i = 0; i < ALLOCS_PER_THREAD; i++) {
+        void *ptr = arena_alloc(8 + (i & 56));
+        bench_consume(ptr);
+        if ((i % ALLOCS_PER_CLEAR) == ALLOCS_PER_CLEAR - 1) {
+            arena_clear();
+        }
+    }
+    pthread_barrier_wait(&start_line);
+
+    arena_delete();
+    return NULL;
+}
+
+/// The same pattern with malloc, freeing every block where
+/// the arena would have been cleared.
+static void *malloc_worker(void *_unused) {
+    (void)_unused;
+    void *held[ALLOCS_PER_CLEAR];
+
+    pthread_barrier_wait(&start_line);
+    for (size_t i = 0; i < ALLOCS_PER_THREAD; i++) {
+        held[i % ALLOCS_PER_CLEAR] = malloc(8 + (i & 56));
+        bench_consume(held[i % ALLOCS_PER_CLEAR]);
+        if ((i % ALLOCS_PER_CLEAR) == ALLOCS_PER_CLEAR - 1) {
+            for (size_t j = 0; j < ALLOCS_PER_CLEAR; j++) {
+                free(held[j]);
+            }
+        }
+    }
+    pthread_barrier_wait(&start_line);
+
+    return NULL;
+}
+
+static void run(const char *name, void *(*worker)(void *), size_t num_threads) {
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    if (!threads) {
+        perror("malloc");
+        exit(1);
+    }
+
+    // The main thread joins the barrier so that thread
+    // creation and arena setup stay out of the timing.
+    pthread_barrier_init(&start_line, NULL, num_threads + 1);
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(threads + i, NULL, worker, NULL) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&start_line);
+    uint64_t start = bench_now_ns();
+    pthread_barrier_wait(&start_line);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    for (size_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&start_line);
+    free(threads);
+
+    // Reported per operation across all threads, so that
+    // ops/s is the aggregate throughput
+    char params[32];
+    (void)snprintf(params, sizeof(params), "threads=%zu", num_threads);
+    bench_report("arena_mt", name, params, (size_t)ALLOCS_PER_THREAD * num_threads, elapsed);
+}
+
+int main(void) {
+    size_t max_threads = (size_t)bench_num_cores() * 2;
+    for (size_t n = 1; n <= max_threads; n *= 2) {
+        run("arena_alloc", arena_worker, n);
+        run("malloc", malloc_worker, n);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include "../include/arena.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ACCESSES 50000000
+
+/// Fills an arena of `size` bytes and then reads random 8-byte
+/// words from all over it, so that nearly every access misses
+/// the TLB when the arena is backed by base pages.
+static void run(const char *name, int flags, size_t size) {
+    arena_t *arena = arena_new_with_flags(flags);
+    arena_set_retention_in(arena, ARENA_RETAIN_ALL, 0);
+
+    uint64_t start = bench_now_ns();
+    uint64_t *words = arena_alloc_nozero_in(arena, size);
+    if (words == NULL) {
+        fprintf(stderr, "%s: couldn't allocate %zu bytes\n", name, size);
+        exit(1);
+    }
+    size_t len = size / sizeof(uint64_t);
+    for (size_t i = 0; i < len; i++) {
+        words[i] = i;
+    }
+    uint64_t fill = bench_now_ns() - start;
+
+    // Power-of-two mask plus an LCG keeps the index math cheap
+    size_t mask = 1;
+    while (mask * 2 <= len) mask *= 2;
+    mask -= 1;
+
+    uint64_t x = 88172645463325252ull;
+    uint64_t sum = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < ACCESSES; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sum += words[(x >> 17) & mask];
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_consume(&sum);
+
+    char params[48];
+    (void)snprintf(params, sizeof(params), "pages=%s size_mb=%zu", name, size >> 20);
+    bench_report("arena_tlb", "fill", params, len, fill);
+    bench_report("arena_tlb", "random_read", params, ACCESSES, elapsed);
+    arena_destroy(arena);
+}
+
+int main(int argc, char **argv) {
+    size_t size_mb = (argc > 1) ? strtoull(argv[1], NULL, 10) : 2048;
+    size_t size = size_mb << 20;
+
+    run("base", 0, size);
+    run("huge", ARENA_HUGE_PAGES, size);
+    return EXIT_SUCCESS;
+}
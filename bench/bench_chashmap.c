@@ -0,0 +1,121 @@
+#include "../include/chashmap.h"
+#include "../include/hashmap.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_KEYS 1000000
+#define OPS_PER_THREAD 5000000
+
+/// One in this many operations is a write.
+#define WRITE_EVERY 50
+
+typedef struct {
+    const char *name;
+    void *map;
+    void *(*get)(void *map, size_t key);
+    void (*put)(void *map, size_t key, void *val);
+} map_ops;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *locked_get(void *map, size_t key) {
+    pthread_mutex_lock(&mutex);
+    void *val = hashmap_get(map, key);
+    pthread_mutex_unlock(&mutex);
+    return val;
+}
+
+static void locked_put(void *map, size_t key, void *val) {
+    pthread_mutex_lock(&mutex);
+    (void)hashmap_remove(map, key);
+    (void)hashmap_insert(map, key, val);
+    pthread_mutex_unlock(&mutex);
+}
+
+static void *concurrent_get(void *map, size_t key) {
+    return chashmap_get(map, key);
+}
+
+static void concurrent_put(void *map, size_t key, void *val) {
+    (void)chashmap_insert(map, key, val);
+}
+
+static const map_ops *current;
+static pthread_barrier_t start_line;
+
+static void *worker(void *ctx) {
+    size_t x = (size_t)ctx * 0x9e3779b97f4a7c15ull + 1;
+
+    pthread_barrier_wait(&start_line);
+    for (size_t i = 0; i < OPS_PER_THREAD; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        size_t key = (x >> 33) % NUM_KEYS + 1;
+        if (i % WRITE_EVERY == 0) {
+            current->put(current->map, key, (void *)key);
+        } else {
+            bench_consume(current->get(current->map, key));
+        }
+    }
+    pthread_barrier_wait(&start_line);
+    return NULL;
+}
+
+static void run(const map_ops *ops, size_t num_threads) {
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+    if (!threads) {
+        perror("malloc");
+        exit(1);
+    }
+
+    current = ops;
+    pthread_barrier_init(&start_line, NULL, num_threads + 1);
+    for (size_t i = 0; i < num_threads; i++) {
+        if (pthread_create(threads + i, NULL, worker, (void *)i) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    pthread_barrier_wait(&start_line);
+    uint64_t start = bench_now_ns();
+    pthread_barrier_wait(&start_line);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    for (size_t i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&start_line);
+    free(threads);
+
+    char params[48];
+    (void)snprintf(params, sizeof(params), "threads=%zu write_every=%d", num_threads, WRITE_EVERY);
+    bench_report("chashmap", ops->name, params, (size_t)OPS_PER_THREAD * num_threads, elapsed);
+}
+
+int main(void) {
+    hashmap_t *locked = hashmap_new();
+    chashmap_t *concurrent = chashmap_new();
+    for (size_t key = 1; key <= NUM_KEYS; key++) {
+        (void)hashmap_insert(locked, key, (void *)key);
+        (void)chashmap_insert(concurrent, key, (void *)key);
+    }
+
+    const map_ops impls[] = {
+        {"mutex", locked, locked_get, locked_put},
+        {"chashmap", concurrent, concurrent_get, concurrent_put},
+    };
+
+    size_t max_threads = (size_t)bench_num_cores() * 2;
+    for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        for (size_t n = 1; n <= max_threads; n *= 2) {
+            run(impls + i, n);
+        }
+    }
+
+    hashmap_delete(locked, NULL);
+    chashmap_delete(concurrent, NULL);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "../include/hash.h"
+#include "../include/hashmap.h"
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_KEYS 4096
+#define ROUNDS 10000
+
+/// A prime table length, like the chained map's used to be,
+/// so that `%` can't be strength-reduced into a mask.
+static volatile size_t prime_len = 1000003;
+static volatile size_t pow2_len = 1 << 20;
+
+static size_t keys[NUM_KEYS];
+
+static void report(const char *name, const char *params, size_t ops, uint64_t ns) {
+    bench_report("hash", name, params, ops, ns);
+}
+
+static uint64_t murmur_u64(size_t key, uint64_t seed) {
+    return murmur3_32((const uint8_t *)&key, sizeof(size_t), (uint32_t)seed);
+}
+
+/// Hash plus index cost alone. Each index feeds the next key
+/// so that the loop measures latency rather than throughput.
+static void run_index(void) {
+    const size_t ops = (size_t)NUM_KEYS * ROUNDS;
+    size_t len = prime_len;
+    size_t mask = pow2_len - 1;
+    size_t acc = 0;
+
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            size_t key = keys[i] ^ (acc & 1);
+            acc = murmur3_32((const uint8_t *)&key, sizeof(size_t), 42) % len;
+        }
+    }
+    report("index", "hash=murmur3_32 reduce=mod", ops, bench_now_ns() - start);
+    bench_consume((void *)acc);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            size_t key = keys[i] ^ (acc & 1);
+            acc = murmur3_32((const uint8_t *)&key, sizeof(size_t), 42) & mask;
+        }
+    }
+    report("index", "hash=murmur3_32 reduce=mask", ops, bench_now_ns() - start);
+    bench_consume((void *)acc);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            acc = (hash_u64(keys[i] ^ (acc & 1), 42) >> 7) & mask;
+        }
+    }
+    report("index", "hash=hash_u64 reduce=mask", ops, bench_now_ns() - start);
+    bench_consume((void *)acc);
+}
+
+/// The same, but through a whole lookup in a small, cache
+/// resident map.
+static void run_get(const char *params, uint64_t (*hash)(size_t, uint64_t)) {
+    hashmap_config_t config = {.hash = hash};
+    hashmap_t *map = hashmap_new_with(&config);
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        (void)hashmap_insert(map, keys[i], (void *)(i + 1));
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            bench_consume(hashmap_get(map, keys[i]));
+        }
+    }
+    report("hashmap_get", params, (size_t)NUM_KEYS * ROUNDS, bench_now_ns() - start);
+
+    hashmap_delete(map, NULL);
+}
+
+/// Byte-string hashing throughput over keys of `len` bytes.
+/// Each hash feeds the next key's first byte, so that the
+/// loop measures latency rather than throughput.
+static void run_bytes(size_t len) {
+    static uint8_t buf[4096];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)hash_u64(i, 1);
+    }
+    const size_t ops = (size_t)ROUNDS * 4096 / len;
+    char params[48];
+    uint64_t acc = 0;
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < ops; i++) {
+        buf[0] = (uint8_t)acc;
+        acc = murmur3_32(buf, len, 42);
+    }
+    (void)snprintf(params, sizeof(params), "hash=murmur3_32 len=%zu", len);
+    report("bytes", params, ops, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < ops; i++) {
+        buf[0] = (uint8_t)acc;
+        acc = hash_bytes(buf, len, 42);
+    }
+    (void)snprintf(params, sizeof(params), "hash=hash_bytes len=%zu", len);
+    report("bytes", params, ops, bench_now_ns() - start);
+    bench_consume((void *)acc);
+}
+
+int main(void) {
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys[i] = hash_u64(i, 0);
+    }
+
+    run_index();
+    run_get("hash=murmur3_32", murmur_u64);
+    run_get("hash=hash_u64", NULL);
+
+    const size_t lens[] = {8, 16, 24, 64, 256, 4096};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        run_bytes(lens[i]);
+    }
+    return EXIT_SUCCESS;
+}
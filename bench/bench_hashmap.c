@@ -0,0 +1,218 @@
+#include "../include/hashmap.h"
+#include "bench.h"
+#include "chained_hashmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Keep small tables busy for at least this many
+/// operations so that their timings are meaningful.
+#define MIN_OPS 4000000
+
+/// The key sizes asked for in the comparison; the largest
+/// can be capped from the command line on smaller machines.
+static const size_t sizes[] = {1000, 1000000, 100000000};
+
+/// Key distributions other than random are only
+/// run on maps up to this size, to keep runs short.
+#define MAX_DIST_KEYS 1000000
+
+typedef struct {
+    const char *name;
+    void *(*new)(void);
+    void (*delete)(void *map);
+    int (*insert)(void *map, size_t key, void *val);
+    void *(*get)(void *map, size_t key);
+    void *(*remove)(void *map, size_t key);
+
+    /// Visits every pair, or NULL if the map can't be iterated.
+    void (*scan)(void *map);
+} map_ops;
+
+static void *swiss_new(void) { return hashmap_new(); }
+static void swiss_delete(void *map) { hashmap_delete(map, NULL); }
+static int swiss_insert(void *map, size_t key, void *val) { return hashmap_insert(map, key, val); }
+static void *swiss_get(void *map, size_t key) { return hashmap_get(map, key); }
+static void *swiss_remove(void *map, size_t key) { return hashmap_remove(map, key); }
+
+static void swiss_scan(void *map) {
+    hashmap_iter_t iter = hashmap_iter(map);
+    void *val;
+    while (hashmap_iter_next(&iter, NULL, &val)) {
+        bench_consume(val);
+    }
+}
+
+static void *chained_new(void) { return chained_hashmap_new(); }
+static void chained_delete(void *map) { chained_hashmap_delete(map, NULL); }
+static int chained_insert(void *map, size_t key, void *val) { return chained_hashmap_insert(map, key, val); }
+static void *chained_get(void *map, size_t key) { return chained_hashmap_get(map, key); }
+static void *chained_remove(void *map, size_t key) { return chained_hashmap_remove(map, key); }
+
+static const map_ops impls[] = {
+    {"chained", chained_new, chained_delete, chained_insert, chained_get, chained_remove, NULL},
+    {"swiss", swiss_new, swiss_delete, swiss_insert, swiss_get, swiss_remove, swiss_scan},
+};
+
+/// Scatters sequential indices over the whole key space.
+static inline size_t key_of(size_t i) {
+    size_t z = i + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static size_t random_key(size_t i) { return key_of(i); }
+
+static size_t sequential_key(size_t i) { return i + 1; }
+
+/// Like a glibc `pthread_t`, which is the address of the thread's
+/// descriptor at the top of its stack: the same low bits, and
+/// spaced a default stack size plus a guard page apart.
+static size_t pthread_key(size_t i) {
+    return 0x7fffd0000700ull - i * (8 * 1024 * 1024 + 4096);
+}
+
+typedef struct {
+    const char *name;
+    size_t (*key)(size_t i);
+} key_dist;
+
+static const key_dist dists[] = {
+    {"random", random_key},
+    {"sequential", sequential_key},
+    {"pthread", pthread_key},
+};
+
+/// The distribution `run` draws keys from.
+static const key_dist *dist = dists;
+
+static void report(const char *impl, const char *op, size_t n, size_t ops, uint64_t ns) {
+    char params[64];
+    (void)snprintf(params, sizeof(params), "impl=%s dist=%s n=%zu", impl, dist->name, n);
+    bench_report("hashmap", op, params, ops, ns);
+}
+
+static void run(const map_ops *impl, size_t n) {
+    size_t rounds = (n >= MIN_OPS) ? 1 : MIN_OPS / n;
+    void *map = impl->new();
+    size_t (*key)(size_t i) = dist->key;
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        (void)impl->insert(map, key(i), (void *)(i + 1));
+    }
+    report(impl->name, "insert", n, n, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            bench_consume(impl->get(map, key(i)));
+        }
+    }
+    report(impl->name, "get_hit", n, n * rounds, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = n; i < 2 * n; i++) {
+            bench_consume(impl->get(map, key(i)));
+        }
+    }
+    report(impl->name, "get_miss", n, n * rounds, bench_now_ns() - start);
+
+    if (impl->scan != NULL) {
+        start = bench_now_ns();
+        for (size_t r = 0; r < rounds; r++) {
+            impl->scan(map);
+        }
+        report(impl->name, "scan", n, n * rounds, bench_now_ns() - start);
+    }
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        bench_consume(impl->remove(map, key(i)));
+    }
+    report(impl->name, "remove", n, n, bench_now_ns() - start);
+
+    impl->delete(map);
+}
+
+/// Loading a known number of keys at startup: one insert at a
+/// time into a fresh map, versus a single bulk insert that sizes
+/// the table once.
+static void run_load(size_t n) {
+    size_t *keys = malloc(sizeof(size_t) * n);
+    void **vals = malloc(sizeof(void *) * n);
+    if (!keys || !vals) {
+        perror("malloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = key_of(i);
+        vals[i] = (void *)(i + 1);
+    }
+
+    hashmap_t *map = hashmap_new();
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        (void)hashmap_insert(map, keys[i], vals[i]);
+    }
+    report("swiss", "load", n, n, bench_now_ns() - start);
+    hashmap_delete(map, NULL);
+
+    map = hashmap_new();
+    start = bench_now_ns();
+    (void)hashmap_insert_bulk(map, keys, vals, n);
+    report("swiss", "load_bulk", n, n, bench_now_ns() - start);
+    hashmap_delete(map, NULL);
+
+    free(keys);
+    free(vals);
+}
+
+/// Counting occurrences of keys drawn from a set of n / 16,
+/// the way it had to be done before the entry API, versus
+/// through a single `hashmap_entry` per update.
+static void run_count(size_t n) {
+    size_t distinct = (n / 16 > 0) ? n / 16 : 1;
+
+    hashmap_t *map = hashmap_new();
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        size_t key = key_of(i % distinct);
+        uintptr_t count = (uintptr_t)hashmap_get(map, key);
+        (void)hashmap_remove(map, key);
+        (void)hashmap_insert(map, key, (void *)(count + 1));
+    }
+    report("swiss", "count", n, n, bench_now_ns() - start);
+    hashmap_delete(map, NULL);
+
+    map = hashmap_new();
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        void **count = hashmap_entry(map, key_of(i % distinct), NULL);
+        (*count) = (void *)((uintptr_t)*count + 1);
+    }
+    report("swiss", "count_entry", n, n, bench_now_ns() - start);
+    hashmap_delete(map, NULL);
+}
+
+int main(int argc, char **argv) {
+    size_t max_keys = (argc > 1) ? strtoull(argv[1], NULL, 10) : (size_t)-1;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (sizes[s] > max_keys) break;
+        for (size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+            if (d > 0 && sizes[s] > MAX_DIST_KEYS) break;
+            dist = dists + d;
+            for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+                run(impls + i, sizes[s]);
+            }
+        }
+
+        dist = dists;
+        run_load(sizes[s]);
+        run_count(sizes[s]);
+    }
+    return EXIT_SUCCESS;
+}
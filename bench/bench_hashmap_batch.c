@@ -0,0 +1,68 @@
+#include "../include/hashmap.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Large enough that the map is many times the size of
+/// a last-level cache, so nearly every lookup misses.
+#define DEFAULT_KEYS (1 << 24)
+#define LOOKUPS (1 << 24)
+
+static const size_t batch_sizes[] = {1, 8, 32, 128};
+
+static inline size_t key_of(size_t i) {
+    size_t z = i + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static void report(const char *name, size_t batch, size_t n, uint64_t ns) {
+    char params[48];
+    (void)snprintf(params, sizeof(params), "batch=%zu n=%zu", batch, n);
+    bench_report("hashmap_batch", name, params, LOOKUPS, ns);
+}
+
+int main(int argc, char **argv) {
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : DEFAULT_KEYS;
+
+    hashmap_t *map = hashmap_with_capacity(n);
+    for (size_t i = 0; i < n; i++) {
+        (void)hashmap_insert(map, key_of(i), (void *)(i + 1));
+    }
+
+    // Random keys that are all in the map, in no useful order
+    size_t *keys = malloc(sizeof(size_t) * LOOKUPS);
+    void **vals = malloc(sizeof(void *) * LOOKUPS);
+    if (!keys || !vals) {
+        perror("malloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        keys[i] = key_of(key_of(i) % n);
+    }
+
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        vals[i] = hashmap_get(map, keys[i]);
+    }
+    report("hashmap_get", 1, n, bench_now_ns() - start);
+    bench_consume(vals);
+
+    for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+        size_t batch = batch_sizes[b];
+        start = bench_now_ns();
+        for (size_t i = 0; i < LOOKUPS; i += batch) {
+            size_t len = (LOOKUPS - i < batch) ? LOOKUPS - i : batch;
+            (void)hashmap_get_many(map, keys + i, len, vals + i);
+        }
+        report("hashmap_get_many", batch, n, bench_now_ns() - start);
+        bench_consume(vals);
+    }
+
+    free(keys);
+    free(vals);
+    hashmap_delete(map, NULL);
+    return EXIT_SUCCESS;
+}
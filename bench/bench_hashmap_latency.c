@@ -0,0 +1,70 @@
+#include "../include/hashmap.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_KEYS 4000000
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline size_t key_of(size_t i) {
+    size_t z = i + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/// Times every single insert into a map that starts empty,
+/// so that the rehashes land inside the measured inserts.
+static void run(const char *name, int flags, size_t n, uint64_t *samples) {
+    hashmap_config_t config = {.flags = flags};
+    hashmap_t *map = hashmap_new_with(&config);
+
+    uint64_t total = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        uint64_t start = bench_now_ns();
+        (void)hashmap_insert(map, key_of(i), (void *)(i + 1));
+        samples[i] = bench_now_ns() - start;
+    }
+    total = bench_now_ns() - total;
+
+    uint64_t get = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        bench_consume(hashmap_get(map, key_of(i)));
+    }
+    get = bench_now_ns() - get;
+
+    // Each percentile is reported as a single operation
+    // that took that long
+    char params[48];
+    qsort(samples, n, sizeof(uint64_t), cmp_u64);
+    (void)snprintf(params, sizeof(params), "rehash=%s n=%zu", name, n);
+    bench_report("hashmap_latency", "insert", params, n, total);
+    bench_report("hashmap_latency", "insert_p50", params, 1, samples[n / 2]);
+    bench_report("hashmap_latency", "insert_p99", params, 1, samples[n - n / 100]);
+    bench_report("hashmap_latency", "insert_p99.9", params, 1, samples[n - n / 1000]);
+    bench_report("hashmap_latency", "insert_max", params, 1, samples[n - 1]);
+    bench_report("hashmap_latency", "get", params, n, get);
+
+    hashmap_delete(map, NULL);
+}
+
+int main(int argc, char **argv) {
+    size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : DEFAULT_KEYS;
+    uint64_t *samples = malloc(sizeof(uint64_t) * n);
+    if (!samples) {
+        perror("malloc");
+        exit(1);
+    }
+
+    run("one-shot", 0, n, samples);
+    run("incremental", HASHMAP_INCREMENTAL_REHASH, n, samples);
+
+    free(samples);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "../include/hashmap.h"
+#include "../include/intern.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_IDENTS 300000
+#define LOOKUPS 10000000
+#define MT_LOOKUPS 2000000
+
+/// Identifier-like strings, e.g. `get_buffer_4711`.
+static const char *words[] = {"get", "set", "buffer", "len", "node", "next", "arena", "map"};
+
+static borrowed_string_t idents[NUM_IDENTS];
+static intern_t *shared;
+
+static void make_idents(void) {
+    size_t n = sizeof(words) / sizeof(words[0]);
+    for (size_t i = 0; i < NUM_IDENTS; i++) {
+        char *buf = malloc(32);
+        if (!buf) {
+            perror("malloc");
+            exit(1);
+        }
+        int len = snprintf(buf, 32, "%s_%s_%zu", words[i % n], words[(i / n) % n], i);
+        idents[i] = (borrowed_string_t) {.len = (size_t)len, .buf = buf};
+    }
+}
+
+static void report(const char *op, const char *params, size_t ops, uint64_t ns) {
+    bench_report("intern", op, params, ops, ns);
+}
+
+/// Interns strings that are all in the table already.
+static void *intern_hits(void *arg) {
+    size_t offset = (size_t)arg;
+    for (size_t i = 0; i < MT_LOOKUPS; i++) {
+        uint32_t id = intern(shared, idents[(offset + i * 7919) % NUM_IDENTS]);
+        bench_consume(&id);
+    }
+    return NULL;
+}
+
+static void run_threads(long threads) {
+    shared = intern_new(INTERN_THREAD_SAFE);
+    for (size_t i = 0; i < NUM_IDENTS; i++) {
+        (void)intern(shared, idents[i]);
+    }
+
+    pthread_t workers[threads];
+    uint64_t start = bench_now_ns();
+    for (long t = 0; t < threads; t++) {
+        if (pthread_create(workers + t, NULL, intern_hits, (void *)(t * 104729)) != 0) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    for (long t = 0; t < threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char params[48];
+    (void)snprintf(params, sizeof(params), "mode=thread_safe threads=%ld", threads);
+    report("intern_hit", params, MT_LOOKUPS * threads, elapsed);
+    intern_delete(shared);
+}
+
+int main(void) {
+    make_idents();
+
+    intern_t *in = intern_new(0);
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < NUM_IDENTS; i++) {
+        (void)intern(in, idents[i]);
+    }
+    report("intern_new", "mode=single", NUM_IDENTS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        uint32_t id = intern(in, idents[(i * 7919) % NUM_IDENTS]);
+        bench_consume(&id);
+    }
+    report("intern_hit", "mode=single", LOOKUPS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        borrowed_string_t str = intern_lookup(in, (uint32_t)((i * 7919) % NUM_IDENTS));
+        bench_consume(str.buf);
+    }
+    report("lookup", "mode=single", LOOKUPS, bench_now_ns() - start);
+
+    // What interning buys: comparing two identifiers
+    // by their bytes, versus by their IDs
+    size_t equal = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        borrowed_string_t a = idents[(i * 7919) % NUM_IDENTS];
+        borrowed_string_t b = idents[(i * 7927) % NUM_IDENTS];
+        equal += a.len == b.len && memcmp(a.buf, b.buf, a.len) == 0;
+    }
+    report("equal", "by=bytes", LOOKUPS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        uint32_t a = (uint32_t)((i * 7919) % NUM_IDENTS);
+        uint32_t b = (uint32_t)((i * 7927) % NUM_IDENTS);
+        equal += a == b;
+    }
+    report("equal", "by=id", LOOKUPS, bench_now_ns() - start);
+    bench_consume(&equal);
+    intern_delete(in);
+
+    for (long threads = 1; threads <= bench_num_cores(); threads *= 2) {
+        run_threads(threads);
+    }
+
+    for (size_t i = 0; i < NUM_IDENTS; i++) {
+        free(idents[i].buf);
+    }
+    return EXIT_SUCCESS;
+}
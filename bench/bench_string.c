@@ -0,0 +1,203 @@
+#include "../include/arena.h"
+#include "../include/string2.h"
+#include "bench.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESSAGES 200000
+#define FIELDS 16
+
+/// The pieces of a message. A "format" message prints each
+/// one with a number, an "append" message copies them verbatim.
+static const char *pieces[] = {"{\"id\":", "\"user\":\"someone@example.com\",",
+                               "\"status\":\"ok\",", "\"latency_ms\":",
+                               "\"region\":\"eu-west-1\",", "\"payload\":\"...\"}"};
+#define NUM_PIECES (sizeof(pieces) / sizeof(pieces[0]))
+
+typedef enum { FORMAT, APPEND } build_t;
+
+/// Builds a message the way callers did without a builder:
+/// one exactly-sized `realloc` per field.
+static size_t build_realloc(build_t how, size_t msg) {
+    char *buf = NULL;
+    size_t len = 0;
+    char field[64];
+    for (size_t i = 0; i < FIELDS; i++) {
+        const char *piece = pieces[i % NUM_PIECES];
+        size_t n = (how == FORMAT)
+            ? (size_t)snprintf(field, sizeof(field), "%s%zu", piece, msg * i)
+            : strlen(piece);
+        char *grown = realloc(buf, len + n + 1);
+        if (grown == NULL) {
+            exit(1);
+        }
+        buf = grown;
+        (void)memcpy(buf + len, (how == FORMAT) ? field : piece, n + 1);
+        len += n;
+    }
+    bench_consume(buf);
+    free(buf);
+    return len;
+}
+
+static void build_fields(owned_string_t *str, build_t how, size_t msg) {
+    for (size_t i = 0; i < FIELDS; i++) {
+        const char *piece = pieces[i % NUM_PIECES];
+        if (how == FORMAT) {
+            (void)string_appendf(str, "%s%zu", piece, msg * i);
+        } else {
+            (void)string_append(str, piece, strlen(piece));
+        }
+    }
+}
+
+/// Builds a message with a malloc'd string builder.
+static size_t build_heap(build_t how, size_t msg) {
+    owned_string_t str;
+    if (!string_alloc(&str)) {
+        exit(1);
+    }
+    build_fields(&str, how, msg);
+    size_t len = str.len;
+    bench_consume(string_buf(&str));
+    string_delete(&str);
+    return len;
+}
+
+/// Builds a message with a string builder in a scratch arena,
+/// which is cleared after every message.
+static size_t build_arena(arena_t *arena, build_t how, size_t msg) {
+    owned_string_t str;
+    if (!string_alloc_in(&str, arena, 16)) {
+        exit(1);
+    }
+    build_fields(&str, how, msg);
+    size_t len = str.len;
+    bench_consume(string_buf(&str));
+    arena_clear_in(arena);
+    return len;
+}
+
+static void run(arena_t *arena, build_t how) {
+    const char *name = (how == FORMAT) ? "format" : "append";
+    size_t bytes = 0;
+
+    uint64_t start = bench_now_ns();
+    for (size_t m = 0; m < MESSAGES; m++) {
+        bytes += build_realloc(how, m);
+    }
+    bench_report("string", name, "impl=realloc", MESSAGES, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t m = 0; m < MESSAGES; m++) {
+        bytes += build_heap(how, m);
+    }
+    bench_report("string", name, "impl=builder", MESSAGES, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t m = 0; m < MESSAGES; m++) {
+        bytes += build_arena(arena, how, m);
+    }
+    bench_report("string", name, "impl=builder_arena", MESSAGES, bench_now_ns() - start);
+
+    bench_consume(&bytes);
+}
+
+/// Short identifiers, the bulk of the strings we keep around,
+/// with the odd one that's too long to be stored inline.
+static const char *corpus[] = {
+    "id", "GET", "POST", "ok", "user_id", "status", "region", "eu-west-1",
+    "latency_ms", "content-type", "host", "x", "true", "false", "null", "en",
+    "session", "token", "account_id", "created_at", "updated_at", "v2",
+    "application/json", "us-east-1", "retry", "timeout", "trace_id", "span",
+    "Accept-Encoding", "keep-alive", "gzip", "X-Request-Id",
+};
+#define CORPUS_LEN (sizeof(corpus) / sizeof(corpus[0]))
+#define CORPUS_ROUNDS 100000
+
+/// A string as callers kept them before `owned_string_t`
+/// stored short strings inline: always a malloc'd buffer.
+typedef struct {
+    size_t len;
+    size_t cap;
+    char *buf;
+} heap_string_t;
+
+static size_t corpus_lens[CORPUS_LEN];
+
+/// Creates and destroys a string for every corpus entry.
+static void run_create(void) {
+    uint64_t start = bench_now_ns();
+    for (size_t r = 0; r < CORPUS_ROUNDS; r++) {
+        for (size_t i = 0; i < CORPUS_LEN; i++) {
+            heap_string_t str = {.len = corpus_lens[i], .cap = corpus_lens[i]};
+            str.buf = malloc(str.cap + 1);
+            (void)memcpy(str.buf, corpus[i], str.len + 1);
+            bench_consume(str.buf);
+            free(str.buf);
+        }
+    }
+    bench_report("string", "create", "impl=malloc", CORPUS_ROUNDS * CORPUS_LEN,
+                 bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < CORPUS_ROUNDS; r++) {
+        for (size_t i = 0; i < CORPUS_LEN; i++) {
+            owned_string_t str;
+            (void)string_alloc(&str);
+            (void)string_append(&str, corpus[i], corpus_lens[i]);
+            bench_consume(string_buf(&str));
+            string_delete(&str);
+        }
+    }
+    bench_report("string", "create", "impl=owned_string", CORPUS_ROUNDS * CORPUS_LEN,
+                 bench_now_ns() - start);
+}
+
+/// Reports the bytes each corpus string takes up, counting
+/// the struct, its heap buffer and malloc's chunk header.
+static void run_footprint(void) {
+    size_t heap_bytes = 0;
+    size_t owned_bytes = 0;
+    size_t spilled = 0;
+    for (size_t i = 0; i < CORPUS_LEN; i++) {
+        char *buf = malloc(corpus_lens[i] + 1);
+        heap_bytes += sizeof(heap_string_t) + malloc_usable_size(buf) + sizeof(size_t);
+        free(buf);
+
+        owned_string_t str;
+        (void)string_alloc(&str);
+        (void)string_append(&str, corpus[i], corpus_lens[i]);
+        owned_bytes += sizeof(owned_string_t);
+        if (!string_is_inline(&str)) {
+            owned_bytes += malloc_usable_size(string_buf(&str)) + sizeof(size_t);
+            spilled++;
+        }
+        string_delete(&str);
+    }
+
+    char params[96];
+    (void)snprintf(params, sizeof(params), "impl=malloc bytes_per_string=%.1f",
+                   (double)heap_bytes / CORPUS_LEN);
+    bench_report("string", "footprint", params, CORPUS_LEN, 0);
+    (void)snprintf(params, sizeof(params), "impl=owned_string bytes_per_string=%.1f spilled=%zu",
+                   (double)owned_bytes / CORPUS_LEN, spilled);
+    bench_report("string", "footprint", params, CORPUS_LEN, 0);
+}
+
+int main(void) {
+    for (size_t i = 0; i < CORPUS_LEN; i++) {
+        corpus_lens[i] = strlen(corpus[i]);
+    }
+
+    arena_t *arena = arena_new();
+    run(arena, APPEND);
+    run(arena, FORMAT);
+    run_create();
+    run_footprint();
+    arena_destroy(arena);
+    return EXIT_SUCCESS;
+}
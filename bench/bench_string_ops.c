@@ -0,0 +1,111 @@
+#define _GNU_SOURCE
+
+#include "../include/string2.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define BYTES_PER_CASE (256ull * 1024 * 1024)
+
+static const size_t lens[] = {8, 24, 64, 256, 4096};
+
+static char *text;
+static char *copy;
+static char *upper;
+
+/// What consumers did before: byte loops over the length.
+static int loop_eq(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static size_t loop_find_byte(const char *str, size_t len, char c) {
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == c) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+static void report(const char *op, const char *impl, size_t len, size_t ops, uint64_t ns) {
+    char params[64];
+    (void)snprintf(params, sizeof(params), "impl=%s len=%zu", impl, len);
+    bench_report("string_ops", op, params, ops, ns);
+}
+
+/// Times `expr` over `ops` iterations, with the string
+/// starting at a different offset on every iteration.
+#define TIME(op, impl, len, expr)                                   \
+    do {                                                            \
+        size_t __ops = BYTES_PER_CASE / (len);                      \
+        size_t __acc = 0;                                           \
+        uint64_t __start = bench_now_ns();                          \
+        for (size_t __i = 0; __i < __ops; __i++) {                  \
+            size_t off = __i & 63;                                  \
+            __acc += (size_t)(expr);                                \
+        }                                                           \
+        report(op, impl, len, __ops, bench_now_ns() - __start);     \
+        bench_consume(&__acc);                                      \
+    } while (0)
+
+static void run(size_t len) {
+    const char *isa = string_isa();
+
+    // Equal strings, which have to be compared in full
+    TIME("eq", "loop", len, loop_eq(text + off, copy + off, len));
+    TIME("eq", "memcmp", len, memcmp(text + off, copy + off, len) == 0);
+    TIME("eq", isa, len, string_eq((borrowed_string_t) {len, text + off},
+                                   (borrowed_string_t) {len, copy + off}));
+
+    // The byte is only in the last position
+    TIME("find_byte", "loop", len, loop_find_byte(text + off, len, '\n'));
+    TIME("find_byte", "memchr", len, memchr(text + off, '\n', len) != NULL);
+    TIME("find_byte", isa, len, string_find_byte((borrowed_string_t) {len, text + off}, '\n'));
+
+    // A needle that almost matches all over the string
+    borrowed_string_t needle = {.len = 4, .buf = "ab\nx"};
+    TIME("find", "memmem", len, memmem(text + off, len, needle.buf, needle.len) != NULL);
+    TIME("find", isa, len, string_find((borrowed_string_t) {len, text + off}, needle));
+
+    TIME("casecmp", "strncasecmp", len, strncasecmp(text + off, upper + off, len));
+    TIME("casecmp", isa, len, string_casecmp((borrowed_string_t) {len, text + off},
+                                             (borrowed_string_t) {len, upper + off}));
+}
+
+int main(void) {
+    size_t max = lens[sizeof(lens) / sizeof(lens[0]) - 1] + 64;
+    text = malloc(max);
+    copy = malloc(max);
+    upper = malloc(max);
+    if (!text || !copy || !upper) {
+        perror("malloc");
+        exit(1);
+    }
+
+    for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+        size_t len = lens[l];
+        // Lowercase text with a newline at the end of each
+        // string, however far into the buffer it starts
+        for (size_t i = 0; i < max; i++) {
+            text[i] = "ab"[i & 1];
+        }
+        for (size_t off = 0; off < 64; off++) {
+            text[off + len - 1] = '\n';
+        }
+        for (size_t i = 0; i < max; i++) {
+            upper[i] = (text[i] >= 'a' && text[i] <= 'z') ? text[i] - 32 : text[i];
+        }
+        memcpy(copy, text, max);
+
+        run(len);
+    }
+
+    free(text);
+    free(copy);
+    free(upper);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include "../include/hash.h"
+#include "../include/hashmap.h"
+#include "../include/strmap.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_KEYS 100000
+#define LOOKUPS 10000000
+
+/// Identifier-like keys, e.g. `get_buffer_len_4711`, between
+/// 8 and 24 bytes long.
+static const char *words[] = {"get", "set", "buffer", "len", "node", "next", "arena", "map"};
+
+typedef struct {
+    size_t len;
+    char buf[32];
+} ident_t;
+
+static void make_key(ident_t *key, size_t i) {
+    size_t n = sizeof(words) / sizeof(words[0]);
+    int len = snprintf(key->buf, sizeof(key->buf), "%s_%s_%zu",
+                       words[i % n], words[(i / n) % n], i);
+    key->len = (size_t)len;
+}
+
+static void report(const char *impl, const char *op, size_t ops, uint64_t ns) {
+    char params[32];
+    (void)snprintf(params, sizeof(params), "impl=%s", impl);
+    bench_report("strmap", op, params, ops, ns);
+}
+
+int main(void) {
+    ident_t *keys = malloc(sizeof(ident_t) * NUM_KEYS * 2);
+    if (!keys) {
+        perror("malloc");
+        exit(1);
+    }
+    for (size_t i = 0; i < NUM_KEYS * 2; i++) {
+        make_key(keys + i, i);
+    }
+
+    // The side-table workaround this map replaces: the string's
+    // hash is the key, and the strings themselves live elsewhere.
+    hashmap_t *hashed = hashmap_new();
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        size_t h = murmur3_32((const uint8_t *)keys[i].buf, keys[i].len, 0);
+        (void)hashmap_insert(hashed, h, keys + i);
+    }
+    report("hashmap+murmur", "insert", NUM_KEYS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const ident_t *key = keys + (i * 7919) % NUM_KEYS;
+        size_t h = murmur3_32((const uint8_t *)key->buf, key->len, 0);
+        const ident_t *found = hashmap_get(hashed, h);
+        bench_consume((found && found->len == key->len &&
+                       memcmp(found->buf, key->buf, key->len) == 0) ? (void *)found : NULL);
+    }
+    report("hashmap+murmur", "get_hit", LOOKUPS, bench_now_ns() - start);
+    hashmap_delete(hashed, NULL);
+
+    strmap_t *map = strmap_new();
+    start = bench_now_ns();
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        (void)strmap_insert(map, keys[i].buf, keys[i].len, keys + i);
+    }
+    report("strmap", "insert", NUM_KEYS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const ident_t *key = keys + (i * 7919) % NUM_KEYS;
+        bench_consume(strmap_get(map, key->buf, key->len));
+    }
+    report("strmap", "get_hit", LOOKUPS, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const ident_t *key = keys + NUM_KEYS + (i * 7919) % NUM_KEYS;
+        bench_consume(strmap_get(map, key->buf, key->len));
+    }
+    report("strmap", "get_miss", LOOKUPS, bench_now_ns() - start);
+    strmap_delete(map, NULL);
+
+    free(keys);
+    return EXIT_SUCCESS;
+}
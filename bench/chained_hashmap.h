@@ -0,0 +1,18 @@
+#ifndef __CHAINED_HASHMAP_H
+#define __CHAINED_HASHMAP_H
+
+#include <stddef.h>
+
+/// The original separately-chained hashmap, kept only so the
+/// benchmarks can compare the open-addressing engine against it.
+typedef struct chained_hashmap_t chained_hashmap_t;
+
+chained_hashmap_t *chained_hashmap_new(void);
+void chained_hashmap_delete(chained_hashmap_t *map, void (*val_free)(void *val));
+
+void *chained_hashmap_get(chained_hashmap_t *map, size_t key);
+int chained_hashmap_insert(chained_hashmap_t *map, size_t key, void *val);
+void *chained_hashmap_remove(chained_hashmap_t *map, size_t key);
+int chained_hashmap_is_empty(chained_hashmap_t *map);
+
+#endif // __CHAINED_HASHMAP_H
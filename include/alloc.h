@@ -7,13 +7,28 @@
 extern "C" {
 #endif
 
+/// A generic allocator. `ctx` is passed as the first
+/// argument to every function, so that one allocator
+/// implementation can serve many independent instances
+/// (e.g. one pool or arena each).
+///
+/// `realloc` resizes a block of `old_n` bytes to `new_n`
+/// bytes, keeping its contents, and returns NULL if it
+/// can't. Allocators that can't resize at all may leave
+/// it NULL. The old size is passed in since allocators
+/// like arenas don't track it themselves.
 typedef struct {
-    void *(*alloc)(const size_t n);
-    void (*free)(void *ptr);
+    void *ctx;
+    void *(*alloc)(void *ctx, const size_t n);
+    void *(*realloc)(void *ctx, void *ptr, const size_t old_n, const size_t new_n);
+    void (*free)(void *ctx, void *ptr);
 } allocator;
 
+/// An allocator backed by malloc, realloc and free.
+allocator heap_allocator(void);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
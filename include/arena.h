@@ -1,6 +1,8 @@
 #ifndef __ARENA_H
 #define __ARENA_H
 
+#include "alloc.h"
+
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -10,6 +12,67 @@ extern "C" {
 typedef struct arena_t arena_t;
 typedef struct arena_temp_t arena_temp_t;
 
+/// Number of buckets in an arena's allocation size histogram.
+#define ARENA_STATS_HISTOGRAM_LEN (sizeof(size_t) * 8)
+
+/// What an arena does with committed memory that it
+/// stops using when it's cleared or a temp arena is
+/// deleted.
+typedef enum {
+    /// Keep every committed page forever.
+    ARENA_RETAIN_ALL = 0,
+
+    /// Return unused pages to the kernel right away
+    /// with MADV_DONTNEED, so that the process' RSS
+    /// shrinks immediately. This is the default.
+    ARENA_RELEASE_EAGER = 1,
+
+    /// Mark unused pages with MADV_FREE, so that the
+    /// kernel reclaims them only under memory pressure
+    /// and reusing them soon after is cheaper.
+    ARENA_RELEASE_LAZY = 2,
+} arena_release_t;
+
+/// A snapshot of an arena's memory use.
+///
+/// `offset` and the committed fields are always filled in.
+/// The rest are only counted when the library is built with
+/// ARENA_STATS (`./configure --enable-arena-stats`), and are
+/// zero otherwise, so that allocations pay nothing for them.
+typedef struct {
+    /// Bytes currently allocated from the arena,
+    /// including alignment padding.
+    size_t offset;
+
+    /// The largest `offset` the arena has ever reached.
+    size_t high_water;
+
+    /// Pages of the arena's reservation that are committed.
+    size_t committed_pages;
+
+    /// Same as `committed_pages`, but in bytes.
+    size_t committed_bytes;
+
+    /// Number of allocations made, including temp allocations.
+    size_t num_allocs;
+
+    /// Bytes skipped over to align allocations.
+    size_t align_waste;
+
+    /// `histogram[i]` counts allocations with sizes in
+    /// [2^i, 2^(i+1)); empty allocations count towards
+    /// `histogram[0]`.
+    size_t histogram[ARENA_STATS_HISTOGRAM_LEN];
+} arena_stats_t;
+
+// -------------------------------------------------
+// IMPLICIT PER-THREAD ARENA
+// -------------------------------------------------
+//
+// These functions operate on the calling thread's
+// own arena, which is created on first use and
+// destroyed when the thread exits.
+
 /// Resets the arena's buffer offset
 /// to 0, effectively freeing all the
 /// allocated memory.
@@ -26,15 +89,60 @@ void arena_clear(void);
 /// NULL pointer.
 void *arena_alloc(const size_t __size);
 
+/// Same as `arena_alloc`, but the returned block
+/// starts at a multiple of `alignment` instead of
+/// the default of two pointers. `alignment` must
+/// be a power of two; 1 packs byte buffers tightly.
+/// Returns NULL for any other alignment, including 0.
+void *arena_alloc_aligned(const size_t __size, const size_t __alignment);
+
+/// Same as `arena_alloc`, but the returned block
+/// is not cleared to zero, so its contents are
+/// unspecified. Use for buffers that are about to
+/// be overwritten anyway.
+void *arena_alloc_nozero(const size_t __size);
+
+/// Sets the least amount of memory, rounded up to
+/// whole pages, that the arena commits whenever it
+/// runs out of committed memory. Commits still grow
+/// geometrically past this, and always cover the
+/// allocation that triggered them.
+void arena_set_commit_granularity(const size_t __granularity);
+
+/// Sets how the arena gives memory back to the kernel
+/// when it's cleared or a temp arena is deleted. The
+/// arena always keeps at least `retain` bytes plus
+/// whatever it used since memory was last released,
+/// and only releases memory if that frees at least
+/// half of what it has committed.
+void arena_set_retention(const arena_release_t __release, const size_t __retain);
+
+/// Fills `out` with the stats of the arena. Returns 1
+/// if the library keeps detailed stats, or 0 if it was
+/// built without ARENA_STATS and only `offset` and the
+/// committed fields are filled in.
+int arena_stats(arena_stats_t *out);
+
+/// Fills `out` with the sum of the stats of every live
+/// arena in the process, so `high_water` is the sum of
+/// each arena's high-water mark. Arenas owned by other
+/// threads keep changing while they're summed, so the
+/// result is only a rough snapshot. Returns the same as
+/// `arena_stats`.
+int arena_stats_global(arena_stats_t *out);
+
 /// Completely frees all memory
 /// associated with arena, including itself.
+/// Threads other than the main thread don't
+/// need to call this before exiting, since
+/// their arena is destroyed along with them.
 void arena_delete(void);
 
 /// This function does not do anything with
 /// the supplied pointer; it was added for
 /// completion and for compatability with
 /// allocator-types.
-void arena_free(void *_unused) {}
+void arena_free(void *_unused);
 
 /// Creates a handle to an existing arena and
 /// that arena's current offset. The returned
@@ -61,6 +169,15 @@ arena_temp_t *arena_temp_new(void);
 /// start of the allocation.
 void *arena_temp_alloc(arena_temp_t *temp, const size_t __size);
 
+/// Same as `arena_alloc_aligned`, but allocates
+/// on the arena that `temp` originated from.
+void *arena_temp_alloc_aligned(arena_temp_t *temp, const size_t __size,
+                               const size_t __alignment);
+
+/// Same as `arena_alloc_nozero`, but allocates
+/// on the arena that `temp` originated from.
+void *arena_temp_alloc_nozero(arena_temp_t *temp, const size_t __size);
+
 /// Deletes a temp arena and returns the original arena's
 /// offset to the one stored in this temp arena. If 
 /// other temps were created after this temp, then
@@ -72,6 +189,82 @@ void *arena_temp_alloc(arena_temp_t *temp, const size_t __size);
 /// persistent allocations again.
 void arena_temp_delete(arena_temp_t *temp);
 
+
+// -------------------------------------------------
+// EXPLICIT ARENAS
+// -------------------------------------------------
+//
+// Independent arenas that are passed around by handle.
+// A thread may own any number of them, so allocations
+// with different lifetimes can be cleared separately.
+// An arena handle must not be used by more than one
+// thread at a time.
+
+/// Creates a new arena with its own reservation
+/// of virtual memory and returns a handle to it,
+/// or NULL if its first pages couldn't be committed.
+arena_t *arena_new(void);
+
+/// Flag for `arena_new_with_flags`: align the arena's
+/// reservation to 2 MB, ask the kernel to back it with
+/// transparent huge pages (MADV_HUGEPAGE), and commit
+/// and release memory in whole huge pages. This cuts
+/// TLB misses for large arenas at the cost of coarser
+/// commits. If the kernel doesn't support transparent
+/// huge pages, the arena silently uses base pages.
+#define ARENA_HUGE_PAGES 0x1
+
+/// Same as `arena_new`, but with any of the
+/// ARENA_* flags above or'd together.
+arena_t *arena_new_with_flags(const int __flags);
+
+/// Allocates `size` bytes within `arena`. Behaves
+/// like `arena_alloc`, including returning a NULL
+/// pointer while a temp arena for `arena` is active.
+void *arena_alloc_in(arena_t *arena, const size_t __size);
+
+/// Same as `arena_alloc_aligned`, but for `arena`.
+void *arena_alloc_aligned_in(arena_t *arena, const size_t __size,
+                             const size_t __alignment);
+
+/// Same as `arena_alloc_nozero`, but for `arena`.
+void *arena_alloc_nozero_in(arena_t *arena, const size_t __size);
+
+/// Resets `arena`'s buffer offset to 0, effectively
+/// freeing all the memory allocated from it.
+void arena_clear_in(arena_t *arena);
+
+/// Completely frees all memory associated with
+/// `arena`, including itself. The handle must not
+/// be used afterwards.
+void arena_destroy(arena_t *arena);
+
+/// Same as `arena_set_retention`, but for `arena`.
+void arena_set_retention_in(arena_t *arena, const arena_release_t __release,
+                            const size_t __retain);
+
+/// Same as `arena_stats`, but for `arena`.
+int arena_stats_in(const arena_t *arena, arena_stats_t *out);
+
+/// Same as `arena_set_commit_granularity`, but for `arena`.
+void arena_set_commit_granularity_in(arena_t *arena, const size_t __granularity);
+
+/// Returns an allocator that allocates from `arena`.
+/// Its `free` does nothing, so everything allocated
+/// through it is freed at once by `arena_clear_in`.
+/// Its `realloc` grows or shrinks the arena's most
+/// recent allocation in place, leaves any other block
+/// where it is when shrinking it, and copies it when
+/// growing it.
+/// Like `arena_alloc_in`, it returns NULL while a temp
+/// arena for `arena` is active.
+allocator arena_allocator(arena_t *arena);
+
+/// Same as `arena_temp_new`, but creates the temp
+/// arena on `arena`. The temp arena is then used
+/// with `arena_temp_alloc` and `arena_temp_delete`.
+arena_temp_t *arena_temp_new_in(arena_t *arena);
+
 #ifdef __cplusplus
 }
 #endif
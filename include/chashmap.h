@@ -0,0 +1,54 @@
+#ifndef __CHASHMAP_H
+#define __CHASHMAP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A hashmap that many threads can use at once. Lookups
+/// never take a lock: they only do atomic loads, and tables
+/// that are replaced while growing are freed once no reader
+/// can still be looking at them. Writers claim slots with
+/// compare-and-swap and only wait for each other while the
+/// table is being rebuilt, which happens when it fills up or
+/// when removed keys take up a quarter of it.
+///
+/// Unlike `hashmap_t`, values can't be NULL, since a NULL
+/// value is how a missing key is reported, and inserting a
+/// key that exists replaces its value.
+typedef struct chashmap_t chashmap_t;
+
+chashmap_t *chashmap_new(void);
+
+/// Frees all memory allocated to the hashmap, optionally freeing
+/// the values in the hashmap as well. No other thread may use the
+/// map while or after it is deleted.
+///
+/// The function pointer follows this convention:
+///     void fn_name(void *ptr_to_value);
+/// The function can assume that all pointers that are
+/// passed-in are non-null.
+void chashmap_delete(chashmap_t *map, void (*val_free)(void *val));
+
+/// Returns the value for `key`, or NULL if there is none.
+/// Never blocks.
+void *chashmap_get(chashmap_t *map, size_t key);
+
+/// Sets the value for `key` to `val`, which must not be NULL,
+/// and returns the value it replaced, or NULL if there was none.
+void *chashmap_insert(chashmap_t *map, size_t key, void *val);
+
+/// Removes `key` and returns its value, or NULL if there was none.
+void *chashmap_remove(chashmap_t *map, size_t key);
+
+/// Returns the number of keys in the map. While other threads
+/// write to the map, this is only a snapshot.
+size_t chashmap_len(chashmap_t *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CHASHMAP_H
@@ -0,0 +1,37 @@
+#ifndef __HASH_H
+#define __HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Hashes `len` bytes starting at `key` with the
+/// 32-bit variant of MurmurHash3.
+uint32_t murmur3_32(const uint8_t *key, size_t len, uint32_t seed);
+
+/// Hashes `len` bytes starting at `key`. Long keys are read
+/// 32 bytes at a time into four independent lanes, so this
+/// is several times faster than `murmur3_32` past a few dozen
+/// bytes, while short keys take one or two multiplies.
+uint64_t hash_bytes(const void *key, size_t len, uint64_t seed);
+
+/// Hashes a 64-bit integer. Unlike running `murmur3_32` over
+/// the key's bytes, this is a handful of multiplies and shifts
+/// that inline into the caller, and every bit of the result
+/// depends on every bit of the key and the seed.
+static inline uint64_t hash_u64(uint64_t key, uint64_t seed) {
+    // The finalizer of SplitMix64, keyed by the seed
+    uint64_t x = key ^ seed;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HASH_H
@@ -1,12 +1,60 @@
 #ifndef __HASHMAP_H
 #define __HASHMAP_H
 
+#include "alloc.h"
+
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct hashmap_t hashmap_t;
 
+/// Options for `hashmap_new_with`. Zero-initialize it and
+/// set only the fields you need; zeroed fields keep their
+/// defaults.
+typedef struct {
+    /// Where the map and its table are allocated from.
+    /// Defaults to the heap. With `arena_allocator`, a
+    /// short-lived map is freed in bulk along with the
+    /// rest of its arena, and never needs `hashmap_delete`.
+    allocator alloc;
+
+    /// How many pairs the map can hold before its first
+    /// rehash, see `hashmap_with_capacity`.
+    size_t capacity;
+
+    /// Any of the HASHMAP_* flags below or'd together.
+    int flags;
+
+    /// Hashes a key with the map's random seed. Defaults
+    /// to `hash_u64`, which suits most integer keys. All 64
+    /// bits of the result are used, so it must mix well.
+    uint64_t (*hash)(size_t key, uint64_t seed);
+} hashmap_config_t;
+
+/// Flag for `hashmap_config_t`: instead of moving every pair
+/// into a larger table within a single insert, keep the old
+/// table around and move a few of its groups on each insert
+/// and remove. This bounds the worst-case insert time of large
+/// maps, at the cost of lookups checking both tables until
+/// the move is done. Lookups don't advance the move.
+#define HASHMAP_INCREMENTAL_REHASH 0x1
+
+/// Flag for `hashmap_config_t`: never shrink the map on removes.
+/// By default, a map that removes have left less than 1/8 full
+/// shrinks to a table about half full, though never below what
+/// it was last asked to reserve.
+#define HASHMAP_NO_AUTO_SHRINK 0x2
+
 hashmap_t *hashmap_new(void);
 
+/// Same as `hashmap_new`, but configured by `config`,
+/// which may be NULL for the defaults.
+hashmap_t *hashmap_new_with(const hashmap_config_t *config);
+
+/// Creates a map whose table is already large enough
+/// to hold `capacity` pairs without rehashing.
+hashmap_t *hashmap_with_capacity(size_t capacity);
+
 /// Frees all memory allocated to the hashmap, optionally freeing
 /// the values in the hashmap as well.
 ///
@@ -17,9 +65,88 @@ hashmap_t *hashmap_new(void);
 void hashmap_delete(hashmap_t *map, void (*val_free)(void *val));
 
 void *hashmap_get(hashmap_t *map, size_t key);
+
+/// Looks up `n` keys at once, storing the value of `keys[i]`
+/// in `out_vals[i]`, or NULL if it's not in the map, and returns
+/// how many keys were found. The keys are hashed and their slots
+/// prefetched in batches before being resolved, so that on large
+/// maps the cache misses of many lookups overlap.
+size_t hashmap_get_many(hashmap_t *map, const size_t *keys, size_t n, void **out_vals);
+
+/// Adds the pair to the map without checking whether `key` is
+/// already in it, which is the fastest way to load keys that are
+/// known to be new. Use `hashmap_upsert` to replace a value.
 int hashmap_insert(hashmap_t *map, size_t key, void *val);
+
+/// Returns a pointer to the value stored for `key`, first adding
+/// `key` with a NULL value if it's not in the map yet, and sets
+/// `inserted` (which may be NULL) to whether it was added. The key
+/// is hashed and probed for once, so read-modify-write updates
+/// like counters cost a single lookup:
+///
+///     void **count = hashmap_entry(map, key, NULL);
+///     (*count) = (void *)((uintptr_t)*count + 1);
+///
+/// The pointer is only valid until the map is next modified.
+void **hashmap_entry(hashmap_t *map, size_t key, int *inserted);
+
+/// Returns the value stored for `key`, first adding
+/// `key` with `val` if it's not in the map yet.
+void *hashmap_get_or_insert(hashmap_t *map, size_t key, void *val);
+
+/// Sets the value stored for `key`, adding `key` if it's not in
+/// the map yet, and returns the value it replaced, or NULL.
+void *hashmap_upsert(hashmap_t *map, size_t key, void *val);
 void *hashmap_remove(hashmap_t *map, size_t key);
 int hashmap_is_empty(hashmap_t *map);
 
+/// Returns the number of pairs in the map.
+size_t hashmap_len(hashmap_t *map);
+
+/// Grows the map's table, if needed, so that the map can hold
+/// `capacity` pairs in total without rehashing again. Rehashing
+/// also drops the slots that removed pairs left behind.
+void hashmap_reserve(hashmap_t *map, size_t capacity);
+
+/// Inserts `n` pairs, `keys[i]` mapping to `vals[i]`. The table
+/// is sized for all of them up front, so this rehashes at most
+/// once, no matter how large `n` is.
+int hashmap_insert_bulk(hashmap_t *map, const size_t *keys, void *const *vals, size_t n);
+
+/// Shrinks the map's storage to the smallest size that holds its
+/// pairs, ignoring any earlier reservation. An empty map gives
+/// back all of its storage.
+void hashmap_shrink_to_fit(hashmap_t *map);
+
+/// Returns how many bytes the map currently holds on to,
+/// including the map itself.
+size_t hashmap_memory_usage(hashmap_t *map);
+
+/// Calls `fn` once for every key/value pair in the map, in
+/// the same order as `hashmap_iter`, passing `ctx` through
+/// untouched. The map must not be modified until this returns.
+void hashmap_for_each(hashmap_t *map, void (*fn)(size_t key, void *val, void *ctx), void *ctx);
+
+/// Walks a map's pairs, which are stored back to back, so a full
+/// scan streams through memory. Pairs come out in the order they
+/// were inserted, except that removing a pair moves the last one
+/// into its place. The map must not be modified while iterating.
+///
+///     hashmap_iter_t iter = hashmap_iter(map);
+///     size_t key;
+///     void *val;
+///     while (hashmap_iter_next(&iter, &key, &val)) { ... }
+typedef struct {
+    hashmap_t *map;
+    size_t next;
+} hashmap_iter_t;
+
+hashmap_iter_t hashmap_iter(hashmap_t *map);
+
+/// Stores the next pair in `key` and `val`, either of which
+/// may be NULL, and returns 1, or returns 0 once every pair
+/// has been visited.
+int hashmap_iter_next(hashmap_iter_t *iter, size_t *key, void **val);
+
 #endif
 
@@ -0,0 +1,59 @@
+#ifndef __INTERN_H
+#define __INTERN_H
+
+#include "string2.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A table of interned strings. Each distinct string is stored
+/// once, in memory the interner owns, and gets a stable integer
+/// ID. IDs are handed out densely from 0, so two interned strings
+/// are equal exactly when their IDs are, and IDs can be used as
+/// `hashmap_t` keys or array indices directly.
+typedef struct intern_t intern_t;
+
+/// Flag for `intern_new`: makes the interner safe to use from
+/// many threads at once. Interning a string that is already in
+/// the table only takes a shared lock, and `intern_lookup` never
+/// takes one.
+#define INTERN_THREAD_SAFE 0x1
+
+/// The ID that `intern_find` returns for strings that
+/// were never interned. No string ever gets this ID.
+#define INTERN_NONE UINT32_MAX
+
+/// Returns a new, empty interner, or NULL if it
+/// couldn't be allocated.
+intern_t *intern_new(const int flags);
+
+/// Frees the interner along with every string in it. No other
+/// thread may use the interner while or after it is deleted.
+void intern_delete(intern_t *intern);
+
+/// Returns the ID of `str`, copying it into the interner
+/// if it's the first time the interner sees it.
+uint32_t intern(intern_t *intern, borrowed_string_t str);
+
+/// Returns the ID of `str`, or INTERN_NONE if it
+/// was never interned. Never copies `str`.
+uint32_t intern_find(intern_t *intern, borrowed_string_t str);
+
+/// Returns the string with the ID `id` in O(1), or an empty
+/// string with a NULL buffer if no string has that ID. The
+/// returned bytes live as long as the interner, and are
+/// followed by a NUL terminator.
+borrowed_string_t intern_lookup(intern_t *intern, uint32_t id);
+
+/// Returns the number of distinct strings interned so far.
+size_t intern_len(intern_t *intern);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __INTERN_H
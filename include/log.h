@@ -22,70 +22,49 @@ extern "C" {
 #define __logln_warn(msg) __logln_warn_fmt(msg "%s", "")
 #define __logln_dbg(msg) __logln_dbg_fmt(msg "%s", "")
 
-#define __logln_info_fmt(msg, ...)  \
+/// Each level's macro only expands to a call when LOG_LEVEL is at
+/// least that level, and to nothing otherwise, so tracing in hot
+/// paths is free unless the library is built with e.g.
+/// `CFLAGS=-DLOG_LEVEL=4`. Disabled calls still type-check their
+/// arguments, but never evaluate them.
+#define __log_off(...)              \
     do {                            \
-        switch (LOG_LEVEL) {        \
-        case 0:                     \
-        case 1:                     \
-        case 2:                     \
-            break;                  \
-        case 3:                     \
-        case 4:                     \
-            dbg(INFO msg "\n", __VA_ARGS__); \
-        default:                    \
-            break;                  \
-        }                           \
+        if (0) dbg(__VA_ARGS__);    \
     } while (0)
 
-#define __logln_warn_fmt(msg, ...)  \
-    do {                            \
-        switch (LOG_LEVEL) {        \
-        case 0:                     \
-        case 1:                     \
-            break;                  \
-        case 2:                     \
-        case 3:                     \
-        case 4:                     \
-            dbg(WARNING msg "\n", __VA_ARGS__); \
-        default:                    \
-            break;                  \
-        }                           \
-    } while (0)
+#if LOG_LEVEL >= 1
+#define __logln_err_fmt(msg, ...) dbg(ERROR msg "\n", __VA_ARGS__)
+#else
+#define __logln_err_fmt(msg, ...) __log_off(msg, __VA_ARGS__)
+#endif
 
-#define __logln_err_fmt(msg, ...)   \
-    do {                            \
-        switch (LOG_LEVEL) {        \
-        case 0:                     \
-            break;                  \
-        case 1:                     \
-        case 2:                     \
-        case 3:                     \
-        case 4:                     \
-            dbg(ERROR msg "\n", __VA_ARGS__); \
-        default:                    \
-            break;                  \
-        }                           \
-    } while (0)
+#if LOG_LEVEL >= 2
+#define __logln_warn_fmt(msg, ...) dbg(WARNING msg "\n", __VA_ARGS__)
+#else
+#define __logln_warn_fmt(msg, ...) __log_off(msg, __VA_ARGS__)
+#endif
 
-#define __logln_dbg_fmt(msg, ...)   \
-    do {                            \
-        switch (LOG_LEVEL) {        \
-        case 0:                     \
-        case 1:                     \
-        case 2:                     \
-        case 3:                     \
-            break;                  \
-        case 4:                     \
-            dbg(DEBUG msg "\n", __VA_ARGS__); \
-        default:                    \
-            break;                  \
-        }                           \
-    } while (0)
+#if LOG_LEVEL >= 3
+#define __logln_info_fmt(msg, ...) dbg(INFO msg "\n", __VA_ARGS__)
+#else
+#define __logln_info_fmt(msg, ...) __log_off(msg, __VA_ARGS__)
+#endif
+
+/// Debug output has a second form without the prefix and
+/// newline, for dumps that are built up over several calls.
+#if LOG_LEVEL >= 4
+#define __logln_dbg_fmt(msg, ...) dbg(DEBUG msg "\n", __VA_ARGS__)
+#define __log_dbg(...) dbg(__VA_ARGS__)
+#else
+#define __logln_dbg_fmt(msg, ...) __log_off(msg, __VA_ARGS__)
+#define __log_dbg(...) __log_off(__VA_ARGS__)
+#endif
 
 
 
 /// Prints a formatted message to
 /// stderr, pretty much like 'fprintf'
+__attribute__((format(printf, 1, 2), unused))
 static void dbg(const char *fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
@@ -0,0 +1,51 @@
+#ifndef __POOL_H
+#define __POOL_H
+
+#include "alloc.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pool_t pool_t;
+
+/// Flag for `pool_new`: makes the pool safe to use from
+/// many threads at once. Each thread keeps a small cache
+/// of free slots, so most allocations and frees don't
+/// touch the pool's lock.
+#define POOL_THREAD_CACHE 0x1
+
+/// Creates a pool of fixed-size slots, each big enough
+/// to hold `obj_size` bytes, carved out of chunks of heap
+/// memory that the pool owns. Returns NULL if the pool
+/// couldn't be allocated.
+///
+/// Without POOL_THREAD_CACHE, a pool must not be used by
+/// more than one thread at a time, just like an arena.
+pool_t *pool_new(const size_t obj_size, const int flags);
+
+/// Returns a free slot from the pool in O(1). The
+/// contents of the slot are unspecified.
+void *pool_alloc(pool_t *pool);
+
+/// Returns `ptr`, which must have come from `pool_alloc`
+/// on the same pool, to the pool in O(1). NULL is ignored.
+void pool_free(pool_t *pool, void *ptr);
+
+/// Frees all memory associated with the pool, including
+/// every slot that was never returned. No thread may use
+/// the pool while or after it is deleted.
+void pool_delete(pool_t *pool);
+
+/// Returns an allocator that hands out slots of `pool`.
+/// Its `alloc` and `realloc` return NULL for requests
+/// larger than the pool's slots.
+allocator pool_allocator(pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __POOL_H
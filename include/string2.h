@@ -1,12 +1,44 @@
 #ifndef __STRING2_H
 #define __STRING2_H
 
+#include "arena.h"
+
+#include <stdarg.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// The longest string that `owned_string_t` stores inline,
+/// inside the struct itself, without allocating.
+#define STRING_INLINE_CAP 15
+
+/// A growable byte string. Its buffer always holds `len`
+/// bytes followed by a NUL terminator, and has room for
+/// `cap` bytes plus the terminator. Use `string_buf` or
+/// `string_view` to get at the bytes.
+///
+/// Strings of up to STRING_INLINE_CAP bytes are stored
+/// inline, so pointers into a short string's buffer are
+/// only valid until the struct itself moves. Longer strings
+/// spill over to a malloc'd buffer.
+/// A zeroed struct (`= {0}`) is a valid empty string.
+///
+/// Strings made with `string_alloc_in` live in an arena
+/// instead, and never store inline. They grow in place as
+/// long as they are the arena's most recent allocation,
+/// and are freed along with the arena.
 typedef struct {
     size_t len;
     size_t cap;
-    char *buf;
+    union {
+        struct {
+            char *buf;
+            arena_t *arena;
+        } heap;
+        char small[STRING_INLINE_CAP + 1];
+    } data;
 } owned_string_t;
 
 typedef struct {
@@ -14,10 +46,112 @@ typedef struct {
     char *buf;
 } borrowed_string_t;
 
+/// Initializes `str` as an empty inline string. Never fails.
 int string_alloc(owned_string_t *str);
+
+/// Initializes `str` as an empty string with room for
+/// `capacity` bytes. Returns 1 on success and 0 if the
+/// buffer couldn't be allocated, in which case `str` is
+/// still a valid, empty inline string.
 int string_alloc_with_cap(owned_string_t *str, size_t capacity);
+
+/// Same as `string_alloc_with_cap`, but the string's
+/// buffer is allocated from `arena`. Fails while a temp
+/// arena is active on `arena`.
+int string_alloc_in(owned_string_t *str, arena_t *arena, size_t capacity);
+
+/// Frees the string's buffer, unless it lives in an arena
+/// or inline, and leaves `str` as an empty inline string.
 void string_delete(owned_string_t *str);
 
+/// Returns 1 if the string is stored inside the struct.
+static inline int string_is_inline(const owned_string_t *str) {
+    return str->cap <= STRING_INLINE_CAP;
+}
+
+/// Returns the string's NUL-terminated buffer.
+static inline char *string_buf(owned_string_t *str) {
+    return string_is_inline(str) ? str->data.small : str->data.heap.buf;
+}
+
+/// Makes sure that `additional` more bytes can be appended
+/// without reallocating. The capacity at least doubles on
+/// every reallocation, so appends are amortized O(1).
+/// Returns 1 on success and 0 if the buffer couldn't grow,
+/// in which case the string is left untouched.
+int string_reserve(owned_string_t *str, size_t additional);
+
+/// Appends the `n` bytes at `bytes`, which must not point
+/// into `str` itself. Returns 1 on success and 0 if the
+/// buffer couldn't grow.
+int string_append(owned_string_t *str, const void *bytes, size_t n);
+
+/// Same as `string_append`, but with a string.
+int string_append_str(owned_string_t *str, borrowed_string_t other);
+
+/// Appends the output of `printf(fmt, ...)`. Returns 1 on
+/// success and 0 if the buffer couldn't grow or `fmt` is
+/// invalid, in which case the string is left untouched.
+int string_appendf(owned_string_t *str, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/// Same as `string_appendf`, but with a `va_list`.
+int string_vappendf(owned_string_t *str, const char *fmt, va_list args);
+
+/// Empties the string, keeping its buffer for reuse.
+void string_clear(owned_string_t *str);
+
+/// Borrows the string's bytes. The view is only valid
+/// until the string is changed, moved or deleted.
 borrowed_string_t string_view(owned_string_t *str);
 
-#endif
\ No newline at end of file
+// The operations below work on any borrowed bytes. They use
+// AVX2 or SSE2 when the CPU has them, picked once at startup,
+// and plain loops otherwise. None of them read past `len`.
+
+/// Returns the instruction set that the operations below
+/// use on this CPU: "avx2", "sse2" or "scalar".
+const char *string_isa(void);
+
+/// What the find functions return when there's no match.
+#define STRING_NOT_FOUND ((size_t)-1)
+
+/// Returns 1 if both strings hold the same bytes.
+int string_eq(borrowed_string_t a, borrowed_string_t b);
+
+/// Returns 1 if `str` starts with `prefix`.
+int string_starts_with(borrowed_string_t str, borrowed_string_t prefix);
+
+/// Returns the index of the first `c` in `str`,
+/// or STRING_NOT_FOUND if there is none.
+size_t string_find_byte(borrowed_string_t str, char c);
+
+/// Returns the index of the first occurrence of `needle`
+/// in `str`, or STRING_NOT_FOUND if there is none. An
+/// empty needle is found at index 0.
+size_t string_find(borrowed_string_t str, borrowed_string_t needle);
+
+/// Splits off the part of `*rest` before the first `delim`,
+/// stores it in `*token` and moves `*rest` past the delimiter.
+/// Returns 0 once every token has been returned. Like with
+/// most splits, "a,,b," gives "a", "", "b" and "", and a
+/// string with a NULL buffer gives no tokens at all.
+///
+/// A typical loop looks like this:
+///     borrowed_string_t rest = line, field;
+///     while (string_split(&rest, ',', &field)) { ... }
+int string_split(borrowed_string_t *rest, char delim, borrowed_string_t *token);
+
+/// Compares two strings like `strcmp`, ignoring the
+/// case of ASCII letters. Other bytes compare as is.
+int string_casecmp(borrowed_string_t a, borrowed_string_t b);
+
+/// Returns 1 if both strings are equal when ignoring
+/// the case of ASCII letters.
+int string_eq_nocase(borrowed_string_t a, borrowed_string_t b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
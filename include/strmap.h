@@ -0,0 +1,60 @@
+#ifndef __STRMAP_H
+#define __STRMAP_H
+
+#include "string2.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A hashmap keyed by arbitrary byte strings. The map copies
+/// every key it stores into its own memory, so callers may reuse
+/// or free their key buffers right after inserting.
+///
+/// Inserting a key that is already in the map replaces its value.
+typedef struct strmap_t strmap_t;
+
+strmap_t *strmap_new(void);
+
+/// Frees all memory allocated to the map, including the copies
+/// of its keys, optionally freeing the values in the map as well.
+///
+/// The function pointer follows this convention:
+///     void fn_name(void *ptr_to_value);
+/// The function can assume that all pointers that are
+/// passed-in are non-null.
+void strmap_delete(strmap_t *map, void (*val_free)(void *val));
+
+/// Returns the value for the `len` bytes at `key`,
+/// or NULL if the key is not in the map.
+void *strmap_get(strmap_t *map, const void *key, size_t len);
+
+/// Sets the value for the `len` bytes at `key` and returns the
+/// value it replaced, or NULL if the key is new to the map.
+void *strmap_insert(strmap_t *map, const void *key, size_t len, void *val);
+
+/// Removes the `len` bytes at `key` from the map and returns its
+/// value, or NULL if the key is not in the map. The map's copy of
+/// the key is freed in bulk by a later insert, once removed keys
+/// take up more memory than the rest of the map.
+void *strmap_remove(strmap_t *map, const void *key, size_t len);
+
+/// Same as `strmap_get`, but with a string key.
+void *strmap_get_str(strmap_t *map, borrowed_string_t key);
+
+/// Same as `strmap_insert`, but with a string key.
+void *strmap_insert_str(strmap_t *map, borrowed_string_t key, void *val);
+
+/// Same as `strmap_remove`, but with a string key.
+void *strmap_remove_str(strmap_t *map, borrowed_string_t key);
+
+/// Returns the number of keys in the map.
+size_t strmap_len(strmap_t *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __STRMAP_H
@@ -0,0 +1,28 @@
+#include "alloc.h"
+
+#include <stdlib.h>
+
+static void *__heap_alloc(void *_ctx, const size_t n) {
+    (void)_ctx;
+    return malloc(n);
+}
+
+static void *__heap_realloc(void *_ctx, void *ptr, const size_t _old_n, const size_t new_n) {
+    (void)_ctx;
+    (void)_old_n;
+    return realloc(ptr, new_n);
+}
+
+static void __heap_free(void *_ctx, void *ptr) {
+    (void)_ctx;
+    free(ptr);
+}
+
+allocator heap_allocator(void) {
+    return (allocator) {
+        .ctx = NULL,
+        .alloc = __heap_alloc,
+        .realloc = __heap_realloc,
+        .free = __heap_free
+    };
+}
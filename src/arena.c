@@ -16,11 +16,20 @@
 
 struct arena_t {
     size_t offset;
+    /// The unit the arena commits and releases memory in,
+    /// which is a huge page for ARENA_HUGE_PAGES arenas.
     const size_t page_size;
     size_t num_pages;
+    size_t commit_granularity;
+    arena_release_t release;
+    size_t retain;
+    size_t peak;
     arena_temp_t *first;
     arena_temp_t *last;
     void *buf;
+#ifdef ARENA_STATS
+    arena_stats_t stats;
+#endif
 };
 
 struct arena_temp_t {
@@ -61,85 +70,111 @@ enum AllocResult {
 #define DEFAULT_ALIGNMENT (2 * sizeof(void *))
 #endif
 
+/// The least amount of memory an arena commits at once.
+/// Arenas grow their committed region geometrically, so
+/// this mostly matters for the first few commits.
+#ifndef ARENA_COMMIT_GRANULARITY
+#define ARENA_COMMIT_GRANULARITY (64 * 1024) // 64 Kilobytes
+#endif
+
+/// Size of the huge pages that ARENA_HUGE_PAGES arenas
+/// align their reservation and their commits to.
+#ifndef ARENA_HUGE_PAGE_SIZE
+#define ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024) // 2 Megabytes
+#endif
+
+/// Flags that implicit per-thread arenas are created with.
+#ifndef ARENA_DEFAULT_FLAGS
+#define ARENA_DEFAULT_FLAGS 0
+#endif
+
+/// What new arenas do with memory they no longer use
+/// once they're cleared, see `arena_release_t`.
+#ifndef ARENA_DEFAULT_RELEASE
+#define ARENA_DEFAULT_RELEASE ARENA_RELEASE_EAGER
+#endif
+
+/// How much committed memory new arenas keep
+/// around after being cleared, regardless of use.
+#ifndef ARENA_DEFAULT_RETAIN
+#define ARENA_DEFAULT_RETAIN (4 * 1024 * 1024) // 4 Megabytes
+#endif
+
 
 // -------------------------------------------------
 // GLOBAL ARENA COLLECTION
 // -------------------------------------------------
 
+/// Every live arena, keyed by its own address.
 static volatile hashmap_t *thread_arenas = NULL;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/// The calling thread's implicit arena, which backs the
+/// handle-less functions in `arena.h`. Looking the arena up
+/// through here instead of `thread_arenas` keeps the allocation
+/// path free of `mutex` and of hashing; the global collection is
+/// only touched when an arena is created or deleted.
+static _Thread_local arena_t *local_arena = NULL;
+
+/// Destroys each thread's implicit arena when the thread exits,
+/// so that exited threads don't leak their reservations.
+static pthread_key_t local_key;
+static pthread_once_t local_key_once = PTHREAD_ONCE_INIT;
+
 int global_exists(void) {
-    hashmap_t *global = (hashmap_t *)thread_arenas;
-    return global != NULL;
+    pthread_mutex_lock(&mutex);
+    int exists = thread_arenas != NULL;
+    pthread_mutex_unlock(&mutex);
+    return exists;
 }
 
 /// Returns a pointer to the global arena collection.
 /// If it doesn't exist, this function initializes
 /// it and returns a pointer to that allocation.
+///
+/// The caller must hold `mutex`, and may only use the
+/// collection until it unlocks it, since another thread
+/// may free the collection as soon as it is empty.
 hashmap_t *global_get(void) {
     hashmap_t *global = (hashmap_t *)thread_arenas;
     if (global == NULL) {
-        pthread_mutex_lock(&mutex);
-        global = (hashmap_t *)thread_arenas;
-        if (global == NULL) {
-            global = hashmap_new();
-            thread_arenas = global;
-        }
-        pthread_mutex_unlock(&mutex);
+        global = hashmap_new();
+        thread_arenas = global;
     }
     return global;
 }
 
 void global_free(void) {
+    pthread_mutex_lock(&mutex);
     hashmap_t *global = (hashmap_t *)thread_arenas;
-    if (global != NULL) {
-        pthread_mutex_lock(&mutex);
-        global = (hashmap_t *)thread_arenas;
-        if (global != NULL) {
-            // HASHMAP MUST BE EMPTY HERE OR ELSE 
-            // THIS WILL LEAK ARENA ALLOCATORS
-            hashmap_delete(global, NULL);
-            thread_arenas = NULL;
-        }
-        pthread_mutex_unlock(&mutex);
+    // Another thread may have created an arena
+    // since the caller saw the collection empty
+    if (global != NULL && hashmap_is_empty(global)) {
+        hashmap_delete(global, NULL);
+        thread_arenas = NULL;
     }
+    pthread_mutex_unlock(&mutex);
 }
 
 int global_insert(arena_t *arena) {
-    hashmap_t *global = global_get();
-    pthread_t self = pthread_self();
     pthread_mutex_lock(&mutex);
-    int success = hashmap_insert(global, (size_t)self, (void *)arena);
+    int success = hashmap_insert(global_get(), (size_t)arena, (void *)arena);
     pthread_mutex_unlock(&mutex);
     return success;
 }
 
-arena_t *global_remove(void) {
-    if (!global_exists()) return NULL;
-    hashmap_t *global = global_get();
-    pthread_t self = pthread_self();
-    pthread_mutex_lock(&mutex);
-    arena_t *arena = hashmap_remove(global, (size_t)self);
-    pthread_mutex_unlock(&mutex);
-    return arena;
-}
-
-arena_t *global_view(void) {
-    if (!global_exists()) return NULL;
-    hashmap_t *global = global_get();
-    pthread_t self = pthread_self();
+arena_t *global_remove(arena_t *arena) {
     pthread_mutex_lock(&mutex);
-    arena_t *arena = hashmap_get(global, (size_t)self);
+    hashmap_t *global = (hashmap_t *)thread_arenas;
+    arena_t *removed = (global != NULL) ? hashmap_remove(global, (size_t)arena) : NULL;
     pthread_mutex_unlock(&mutex);
-    return arena;
+    return removed;
 }
 
 int global_is_empty(void) {
-    if (!global_exists()) return 1;
-    hashmap_t *global = global_get();
     pthread_mutex_lock(&mutex);
-    int empty = hashmap_is_empty(global);
+    hashmap_t *global = (hashmap_t *)thread_arenas;
+    int empty = (global == NULL) || hashmap_is_empty(global);
     pthread_mutex_unlock(&mutex);
     return empty;
 }
@@ -152,36 +187,65 @@ int global_is_empty(void) {
 /// Helper function to the `arena_new` function,
 /// reserves the page-aligned amount of virtual
 /// memory as defined by MAX_ALLOC_SPACE, but does
-/// not actually reserve any physical memory.
+/// not actually reserve any physical memory. The
+/// reservation starts at a multiple of `pagesize`,
+/// even if that is larger than the system's pages.
 ///
 /// Returns a pointer to the start of the new
-/// mapping, or NULL if the mapping failed.
+/// mapping, or MAP_FAILED if the mapping failed.
 /// It is recommended to handle this failure
 /// by exiting out of the program.
 static void *__reserve_mem(const size_t pagesize);
 
-/// Attempts to map a new page of physical memory using mmap(). If
-/// successful, returns ALLOC_SUCCESS, otherwise the mapping failed
+/// Commits enough of the arena's reservation with mprotect() for
+/// the arena to span at least `new_arena_size` bytes. The committed
+/// region at least doubles each time, so any single request costs
+/// one syscall and a run of requests costs O(log n) syscalls. If
+/// successful, returns ALLOC_SUCCESS, otherwise the commit failed
 /// and the result should be handled.
-static enum AllocResult __map_new_page(arena_t *arena, const uintptr_t new_arena_size);
+static enum AllocResult __commit_pages(arena_t *arena, const uintptr_t new_arena_size);
+
+/// Called after the arena's offset was moved back. Returns the
+/// committed pages that the arena neither retains nor used since
+/// the last call to the kernel, according to its release policy.
+///
+/// For hysteresis, pages are only released if that would give
+/// back at least half of the committed memory, and the memory
+/// used since the last call is always kept, so a workload that
+/// reaches the same peak every cycle never has to recommit.
+static void __release_pages(arena_t *arena);
 
 /// Aligns the address with the specified alignment and returns the
 /// new address that the next allocation should start at.
 static uintptr_t align(const uintptr_t ptr, const size_t alignment);
 
-/// Returns 1 if true, 0 if false.
-inline int is_power_of_two(const uintptr_t x);
+/// Returns 1 if true, 0 if false. 0 is not a power of two.
+static inline int is_power_of_two(const uintptr_t x);
 
 /// Attempts to allocate memory with the given arena, but will
 /// return NULL if the arena has any temp arenas attached to itself.
 ///
 /// This function will also error out of the program if the given
 /// allocator is NULL.
-void *alloc_checked(arena_t *arena, const size_t size);
+void *alloc_checked(arena_t *arena, const size_t size,
+                    const size_t alignment, const int zeroed);
 
 /// Attempts to allocate memory without checking if the given
-/// arena has any temp arenas attached to itself.
-void *alloc_unchecked(arena_t *arena, const size_t size);
+/// arena has any temp arenas attached to itself. The block starts
+/// at a multiple of `alignment`, and is only cleared to zero if
+/// `zeroed` is nonzero. Returns NULL if `alignment` isn't a power
+/// of two.
+void *alloc_unchecked(arena_t *arena, const size_t size,
+                      const size_t alignment, const int zeroed);
+
+/// Returns the calling thread's implicit arena,
+/// creating it if it doesn't exist yet.
+static arena_t *local_get(void);
+
+/// Records an allocation of `size` bytes that skipped `padding`
+/// bytes to reach its alignment. Compiles to nothing unless the
+/// library was built with ARENA_STATS.
+static inline void __stats_record(arena_t *arena, const size_t size, const size_t padding);
 
 /// Compares two temp arenas and returns 1 if they are the same.
 /// Otherwise returns 0.
@@ -193,21 +257,24 @@ void print_arena_info(const arena_t *arena);
 void print_temp_info(const arena_temp_t *temp);
 void print_arena(const arena_t *arena);
 
-/// Allocates memory for an arena
-/// and returns a pointer to it.
-arena_t *arena_new(void);
-
 
 // --------------------------------------------------------------
 // ARENA ALLOCATOR DEFINITIONS
 // --------------------------------------------------------------
 
 arena_t *arena_new(void) {
+    return arena_new_with_flags(0);
+}
+
+arena_t *arena_new_with_flags(const int flags) {
     long page_size = sysconf(_SC_PAGE_SIZE);
     if (page_size == -1) {
         __logln_err_fmt("Sysconf: %s", strerror(errno));
         exit(1);
     }
+    if ((flags & ARENA_HUGE_PAGES) && page_size < ARENA_HUGE_PAGE_SIZE) {
+        page_size = ARENA_HUGE_PAGE_SIZE;
+    }
 
     void *non_committed_addr = __reserve_mem(page_size);
     if (non_committed_addr == MAP_FAILED) {
@@ -215,17 +282,27 @@ arena_t *arena_new(void) {
         exit(1);
     }
 
-    void *addr = mmap(non_committed_addr, page_size, PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if ((flags & ARENA_HUGE_PAGES)
+        && madvise(non_committed_addr, MAX_ALLOC_SPACE, MADV_HUGEPAGE) == -1) {
+        // Still works, just with base pages
+        __logln_warn_fmt("Transparent huge pages unavailable: %s", strerror(errno));
+    }
 
-    if (addr == MAP_FAILED) {
+    const size_t commit_granularity = align(ARENA_COMMIT_GRANULARITY, page_size);
+    void *addr = non_committed_addr;
+    if (mprotect(addr, commit_granularity, PROT_READ | PROT_WRITE) == -1) {
         __logln_warn_fmt("%s", strerror(errno));
+        (void)munmap(addr, MAX_ALLOC_SPACE);
         return NULL;
     }
 
     arena_t arena = {
         .buf = (void *)((uintptr_t) addr + sizeof(arena_t)),
-        .num_pages = 1,
+        .num_pages = commit_granularity / page_size,
+        .commit_granularity = commit_granularity,
+        .release = ARENA_DEFAULT_RELEASE,
+        .retain = ARENA_DEFAULT_RETAIN,
+        .peak = 0,
         .offset = 0,
         .first = NULL,
         .last = NULL,
@@ -236,7 +313,7 @@ arena_t *arena_new(void) {
 
     int success = global_insert((arena_t *) addr);
     if (!success) {
-        __logln_err("There currently can't be more than one arena per thread");
+        __logln_err("Couldn't register the new arena");
         exit(1);
     }
 
@@ -248,58 +325,141 @@ static void *__reserve_mem(const size_t page_size) {
     size_t max_num_pages = max_alloc_space / page_size;
     size_t total_page_size = max_num_pages * page_size;
 
-    dbg("[%s:%lu] total_page_size = %lu\n", __FILE__, __LINE__,
-        total_page_size);
+    __logln_dbg_fmt("Reserving %lu bytes for arena", total_page_size);
+
+    // mmap only aligns to the system's pages, so reserve one
+    // extra page and trim the mapping down to an aligned one
+    size_t slack = page_size;
+    void *addr = mmap(NULL, total_page_size + slack, PROT_NONE,
+                      MAP_ANONYMOUS | MAP_NORESERVE | MAP_PRIVATE, -1, 0);
+    if (addr == MAP_FAILED) return addr;
 
-    return mmap(NULL, total_page_size, PROT_NONE,
-                MAP_ANONYMOUS | MAP_NORESERVE | MAP_PRIVATE, -1, 0);
+    uintptr_t start = align((uintptr_t)addr, page_size);
+    size_t head = start - (uintptr_t)addr;
+    if (head > 0) {
+        (void)munmap(addr, head);
+    }
+    (void)munmap((void *)(start + total_page_size), slack - head);
+
+    return (void *)start;
 }
 
-void *arena_alloc(const size_t size) {
-    arena_t *arena = global_view();
-    if (arena == NULL) {
-        arena = arena_new();
+static void local_destroy(void *arena) {
+    arena_destroy((arena_t *)arena);
+}
+
+static void local_key_create(void) {
+    if (pthread_key_create(&local_key, local_destroy) != 0) {
+        __logln_err("Couldn't create the thread exit hook for arenas");
+        exit(1);
+    }
+}
+
+static arena_t *local_get(void) {
+    if (local_arena == NULL) {
+        (void)pthread_once(&local_key_once, local_key_create);
+        local_arena = arena_new_with_flags(ARENA_DEFAULT_FLAGS);
+        (void)pthread_setspecific(local_key, local_arena);
     }
-    return alloc_checked(arena, size);
+    return local_arena;
+}
+
+void *arena_alloc(const size_t size) {
+    return alloc_checked(local_get(), size, DEFAULT_ALIGNMENT, 1);
+}
+
+void *arena_alloc_aligned(const size_t size, const size_t alignment) {
+    return alloc_checked(local_get(), size, alignment, 1);
+}
+
+void *arena_alloc_nozero(const size_t size) {
+    return alloc_checked(local_get(), size, DEFAULT_ALIGNMENT, 0);
 }
 
-void *alloc_checked(arena_t *arena, const size_t size) {
+void *arena_alloc_in(arena_t *arena, const size_t size) {
+    return alloc_checked(arena, size, DEFAULT_ALIGNMENT, 1);
+}
+
+void *arena_alloc_aligned_in(arena_t *arena, const size_t size, const size_t alignment) {
+    return alloc_checked(arena, size, alignment, 1);
+}
+
+void *arena_alloc_nozero_in(arena_t *arena, const size_t size) {
+    return alloc_checked(arena, size, DEFAULT_ALIGNMENT, 0);
+}
+
+void *alloc_checked(arena_t *arena, const size_t size,
+                    const size_t alignment, const int zeroed) {
     assert(arena != NULL);
 
     if (arena->last == NULL)
-        return alloc_unchecked(arena, size);
+        return alloc_unchecked(arena, size, alignment, zeroed);
     else
         return NULL;
 }
 
-void *alloc_unchecked(arena_t *arena, const size_t size) {
+void *alloc_unchecked(arena_t *arena, const size_t size,
+                      const size_t alignment, const int zeroed) {
+    if (!is_power_of_two(alignment)) return NULL;
+
     const uintptr_t cur_addr = (uintptr_t)arena->buf + (uintptr_t)arena->offset;
-    const uintptr_t offset = align(cur_addr, DEFAULT_ALIGNMENT);
+    const uintptr_t offset = align(cur_addr, alignment);
     const uintptr_t arena_size = offset - (uintptr_t)arena;
 
-    if (arena_size + size >= arena->page_size * arena->num_pages) {
-        switch (__map_new_page(arena, arena_size)) {
+    if (size > MAX_ALLOC_SPACE - arena_size) {
+        // Error out, we hit the max
+        __logln_err_fmt("Arena can't hold another %lu bytes", size);
+        exit(1);
+    }
+
+    if (arena_size + size > arena->page_size * arena->num_pages) {
+        switch (__commit_pages(arena, arena_size + size)) {
         case OUT_OF_VIRT:
             // Error out, we hit the max
-            __logln_err_fmt("%s", strerror(errno));
+            __logln_err_fmt("Arena can't hold another %lu bytes", size);
             exit(1);
         case ALLOC_FAILED:
-            __logln_warn("Could not map a new page");
+            __logln_warn("Could not commit more pages");
             return NULL;
         case ALLOC_SUCCESS:
-            arena->num_pages++;
+            break;
         }
     }
 
     const uintptr_t relative_offset = offset - (uintptr_t)arena->buf;
     void *ret = (void *)((uintptr_t)arena->buf + relative_offset);
     arena->offset = relative_offset + size;
+    if (arena->offset > arena->peak) {
+        arena->peak = arena->offset;
+    }
+    __stats_record(arena, size, offset - cur_addr);
 
-    (void)memset(ret, 0, size);
+    if (zeroed) {
+        (void)memset(ret, 0, size);
+    }
 
     return ret;
 }
 
+static inline void __stats_record(arena_t *arena, const size_t size, const size_t padding) {
+#ifdef ARENA_STATS
+    arena_stats_t *stats = &arena->stats;
+    stats->num_allocs++;
+    stats->align_waste += padding;
+    if (arena->offset > stats->high_water) {
+        stats->high_water = arena->offset;
+    }
+
+    // Bucket i holds sizes in [2^i, 2^(i+1)), and size 0 goes to bucket 0
+    size_t bucket = (size == 0) ? 0 : (sizeof(size_t) * 8 - 1) - __builtin_clzl(size);
+    stats->histogram[bucket]++;
+#else
+    (void)arena;
+    (void)size;
+    (void)padding;
+#endif
+}
+
 static uintptr_t align(const uintptr_t ptr, const size_t alignment) {
     assert(is_power_of_two(alignment));
 
@@ -316,32 +476,79 @@ static uintptr_t align(const uintptr_t ptr, const size_t alignment) {
     return ret;
 }
 
-inline int is_power_of_two(const uintptr_t x) { return (x & (x - 1)) == 0; }
+static inline int is_power_of_two(const uintptr_t x) { return x != 0 && (x & (x - 1)) == 0; }
 
-static enum AllocResult __map_new_page(arena_t *arena, const uintptr_t new_arena_size) {
+static enum AllocResult __commit_pages(arena_t *arena, const uintptr_t new_arena_size) {
     const uintptr_t max_alloc_space = MAX_ALLOC_SPACE;
-    if (new_arena_size >= max_alloc_space - arena->page_size) {
+    if (new_arena_size > max_alloc_space) {
         return OUT_OF_VIRT;
     }
 
-    void *next_addr = arena + arena->page_size;
-
-    next_addr = mmap(next_addr, arena->page_size + 1, PROT_READ | PROT_WRITE,
-                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    const uintptr_t committed = arena->page_size * arena->num_pages;
+    uintptr_t new_committed = committed * 2;
+    if (new_committed < committed + arena->commit_granularity) {
+        new_committed = committed + arena->commit_granularity;
+    }
+    if (new_committed < new_arena_size) {
+        new_committed = new_arena_size;
+    }
+    new_committed = align(new_committed, arena->page_size);
+    if (new_committed > max_alloc_space) {
+        new_committed = max_alloc_space - max_alloc_space % arena->page_size;
+    }
 
-    if (next_addr == MAP_FAILED) {
+    void *next_addr = (void *)((uintptr_t)arena + committed);
+    if (mprotect(next_addr, new_committed - committed, PROT_READ | PROT_WRITE) == -1) {
         __logln_err_fmt("%s", strerror(errno));
         return ALLOC_FAILED;
     }
 
+    arena->num_pages = new_committed / arena->page_size;
     return ALLOC_SUCCESS;
 }
 
-void arena_delete(void) {
-    arena_t *arena = global_remove();
+static void __release_pages(arena_t *arena) {
+    const uintptr_t header_size = (uintptr_t)arena->buf - (uintptr_t)arena;
+    uintptr_t keep = arena->peak;
+    if (keep < arena->retain) {
+        keep = arena->retain;
+    }
+    keep = align(header_size + keep, arena->page_size);
+    arena->peak = arena->offset;
+
+    const uintptr_t committed = arena->page_size * arena->num_pages;
+    if (arena->release == ARENA_RETAIN_ALL || committed / 2 < keep) {
+        return;
+    }
+
+    void *start = (void *)((uintptr_t)arena + keep);
+    const size_t len = committed - keep;
+    int advice = (arena->release == ARENA_RELEASE_LAZY) ? MADV_FREE : MADV_DONTNEED;
+    if (madvise(start, len, advice) == -1 && advice == MADV_FREE) {
+        // MADV_FREE needs Linux 4.5, fall back to freeing eagerly
+        advice = MADV_DONTNEED;
+        (void)madvise(start, len, advice);
+    }
+
+    // Hand the range back to the reservation, so that it
+    // gets committed again like any other fresh memory
+    if (mprotect(start, len, PROT_NONE) == -1) {
+        __logln_warn_fmt("%s", strerror(errno));
+        return;
+    }
+    arena->num_pages = keep / arena->page_size;
+}
+
+void arena_destroy(arena_t *arena) {
     if (arena == NULL) return;
+    if (arena == local_arena) {
+        local_arena = NULL;
+        (void)pthread_setspecific(local_key, NULL);
+    }
+
+    if (global_remove(arena) == NULL) return;
     if (munmap(arena, MAX_ALLOC_SPACE) == -1) {
-        dbg("%s\n", strerror(errno));
+        __logln_warn_fmt("%s", strerror(errno));
     }
 
     if (global_is_empty()) {
@@ -349,28 +556,171 @@ void arena_delete(void) {
     }
 }
 
+void arena_delete(void) {
+    arena_destroy(local_arena);
+}
+
+int arena_stats_in(const arena_t *arena, arena_stats_t *out) {
+#ifdef ARENA_STATS
+    (*out) = arena->stats;
+#else
+    (void)memset(out, 0, sizeof(arena_stats_t));
+#endif
+    out->offset = arena->offset;
+    out->committed_pages = arena->num_pages;
+    out->committed_bytes = arena->num_pages * arena->page_size;
+
+#ifdef ARENA_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int arena_stats(arena_stats_t *out) {
+    return arena_stats_in(local_get(), out);
+}
+
+/// Adds the stats of the arena `val` to the stats in `ctx`.
+static void __stats_accumulate(size_t _key, void *val, void *ctx) {
+    (void)_key;
+    arena_stats_t *total = ctx;
+    arena_stats_t stats;
+    int enabled = arena_stats_in(val, &stats);
+
+    total->offset += stats.offset;
+    total->committed_pages += stats.committed_pages;
+    total->committed_bytes += stats.committed_bytes;
+    if (!enabled) return;
+
+    total->high_water += stats.high_water;
+    total->num_allocs += stats.num_allocs;
+    total->align_waste += stats.align_waste;
+    for (size_t i = 0; i < ARENA_STATS_HISTOGRAM_LEN; i++) {
+        total->histogram[i] += stats.histogram[i];
+    }
+}
+
+int arena_stats_global(arena_stats_t *out) {
+    (void)memset(out, 0, sizeof(arena_stats_t));
+    pthread_mutex_lock(&mutex);
+    hashmap_t *global = (hashmap_t *)thread_arenas;
+    if (global != NULL) {
+        hashmap_for_each(global, __stats_accumulate, out);
+    }
+    pthread_mutex_unlock(&mutex);
+
+#ifdef ARENA_STATS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void arena_set_commit_granularity_in(arena_t *arena, const size_t granularity) {
+    arena->commit_granularity = align(granularity, arena->page_size);
+}
+
+void arena_set_commit_granularity(const size_t granularity) {
+    arena_set_commit_granularity_in(local_get(), granularity);
+}
+
+void arena_free(void *_unused) {
+    (void)_unused;
+}
+
+static void *__allocator_alloc(void *ctx, const size_t n) {
+    return alloc_checked(ctx, n, DEFAULT_ALIGNMENT, 0);
+}
+
+static void __allocator_free(void *_ctx, void *_unused) {
+    (void)_ctx;
+    (void)_unused;
+}
+
+static void *__allocator_realloc(void *ctx, void *ptr, const size_t old_n, const size_t new_n) {
+    arena_t *arena = ctx;
+    if (arena->last != NULL) {
+        return NULL;
+    }
+
+    // The most recent allocation ends at the offset, so it
+    // can be resized by just moving the offset
+    const uintptr_t start = (uintptr_t)ptr - (uintptr_t)arena->buf;
+    if (ptr != NULL && start + old_n == (uintptr_t)arena->offset) {
+        const uintptr_t arena_size = (uintptr_t)ptr - (uintptr_t)arena;
+        if (new_n > MAX_ALLOC_SPACE - arena_size) {
+            return NULL;
+        }
+        if (arena_size + new_n > arena->page_size * arena->num_pages
+            && __commit_pages(arena, arena_size + new_n) != ALLOC_SUCCESS) {
+            return NULL;
+        }
+
+        arena->offset = start + new_n;
+        if (arena->offset > arena->peak) {
+            arena->peak = arena->offset;
+        }
+        return ptr;
+    }
+
+    // Any other block can't give memory back, so
+    // shrinking it would only waste a copy
+    if (ptr != NULL && new_n <= old_n) {
+        return ptr;
+    }
+
+    void *ret = alloc_unchecked(arena, new_n, DEFAULT_ALIGNMENT, 0);
+    if (ret != NULL && ptr != NULL) {
+        (void)memcpy(ret, ptr, (old_n < new_n) ? old_n : new_n);
+    }
+    return ret;
+}
+
+allocator arena_allocator(arena_t *arena) {
+    return (allocator) {
+        .ctx = arena,
+        .alloc = __allocator_alloc,
+        .realloc = __allocator_realloc,
+        .free = __allocator_free
+    };
+}
+
+void arena_set_retention_in(arena_t *arena, const arena_release_t release, const size_t retain) {
+    arena->release = release;
+    arena->retain = retain;
+}
+
+void arena_set_retention(const arena_release_t release, const size_t retain) {
+    arena_set_retention_in(local_get(), release, retain);
+}
+
+void arena_clear_in(arena_t *arena) {
+    arena->offset = 0;
+    arena->first = NULL;
+    arena->last = NULL;
+    __release_pages(arena);
+}
+
 void arena_clear(void) {
-    arena_t *arena = global_view();
-    if (arena != NULL) {
-        arena->offset = 0;
-        arena->first = NULL;
-        arena->last = NULL;
+    if (local_arena != NULL) {
+        arena_clear_in(local_arena);
     }
 }
 
 arena_temp_t *arena_temp_new(void) {
-    arena_t *arena = global_view();
-    if (arena == NULL) {
-        arena = arena_new();
-    }
+    return arena_temp_new_in(local_get());
+}
 
+arena_temp_t *arena_temp_new_in(arena_t *arena) {
     arena_temp_t tmp = {
         .arena = arena, 
         .saved_offset = arena->offset, 
         .next = NULL
     };
 
-    arena_temp_t *temp_arena = alloc_unchecked(arena, sizeof(arena_temp_t));
+    arena_temp_t *temp_arena = alloc_unchecked(arena, sizeof(arena_temp_t),
+                                               DEFAULT_ALIGNMENT, 0);
     if (temp_arena != NULL) {
         (void) memcpy(temp_arena, &tmp, sizeof(arena_temp_t));
         arena_temp_t *last = arena->last;
@@ -386,15 +736,24 @@ arena_temp_t *arena_temp_new(void) {
 }
 
 void *arena_temp_alloc(arena_temp_t *temp, const size_t size) {
-    return alloc_unchecked(temp->arena, size);
+    return alloc_unchecked(temp->arena, size, DEFAULT_ALIGNMENT, 1);
+}
+
+void *arena_temp_alloc_aligned(arena_temp_t *temp, const size_t size, const size_t alignment) {
+    return alloc_unchecked(temp->arena, size, alignment, 1);
+}
+
+void *arena_temp_alloc_nozero(arena_temp_t *temp, const size_t size) {
+    return alloc_unchecked(temp->arena, size, DEFAULT_ALIGNMENT, 0);
 }
 
 void arena_temp_delete(arena_temp_t *temp) {
+    if (temp == NULL)
+        return;
+
     arena_t *arena = temp->arena;
-    print_arena(arena);
-    print_linked_list(arena->first);
     arena_temp_t *visitor = arena->first;
-    if (visitor == NULL || temp == NULL)
+    if (visitor == NULL)
         return;
 
     if (temp_arena_eq(visitor, temp) == 1) {
@@ -406,6 +765,7 @@ void arena_temp_delete(arena_temp_t *temp) {
     while (visitor_next != NULL) {
         if (temp_arena_eq(visitor_next, temp) == 1) {
             visitor->next = NULL;
+            arena->last = visitor;
             break;
         }
 
@@ -414,9 +774,7 @@ void arena_temp_delete(arena_temp_t *temp) {
     }
 
     arena->offset = temp->saved_offset;
-
-    print_arena(arena);
-    print_linked_list(arena->first);
+    __release_pages(arena);
 }
 
 int temp_arena_eq(const arena_temp_t *self, const arena_temp_t *other) {
@@ -435,45 +793,45 @@ void print_linked_list(arena_temp_t *start) {
 }
 
 void print_arena(const arena_t *arena) {
-    dbg("[%s:%u] arena_t [%p] {\n", __FILE__, __LINE__, arena);
-    dbg("  .offset = %lu\n", arena->offset);
-    dbg("  .page_size = %lu\n", arena->page_size);
-    dbg("  .num_pages = %lu\n", arena->num_pages);
-    dbg("  .first = ");
+    __log_dbg("[%s:%u] arena_t [%p] {\n", __FILE__, __LINE__, arena);
+    __log_dbg("  .offset = %lu\n", arena->offset);
+    __log_dbg("  .page_size = %lu\n", arena->page_size);
+    __log_dbg("  .num_pages = %lu\n", arena->num_pages);
+    __log_dbg("  .first = ");
     print_temp_info(arena->first);
-    dbg(",\n");
-    dbg("  .last = ");
+    __log_dbg(",\n");
+    __log_dbg("  .last = ");
     print_temp_info(arena->last);
-    dbg(",\n");
-    dbg("  .buf = (void *) [%p]\n", arena->buf);
-    dbg("}\n");
+    __log_dbg(",\n");
+    __log_dbg("  .buf = (void *) [%p]\n", arena->buf);
+    __log_dbg("}\n");
 }
 
 void print_arena_temp(const arena_temp_t *temp) {
-    dbg("[%s:%u] arena_temp_t [%p] {\n", __FILE__, __LINE__, temp);
-    dbg("  .saved_offset = %lu,\n", temp->saved_offset);
-    dbg("  .arena = ");
+    __log_dbg("[%s:%u] arena_temp_t [%p] {\n", __FILE__, __LINE__, temp);
+    __log_dbg("  .saved_offset = %lu,\n", temp->saved_offset);
+    __log_dbg("  .arena = ");
     print_arena_info(temp->arena);
-    dbg(",\n");
-    dbg("  .next = ");
+    __log_dbg(",\n");
+    __log_dbg("  .next = ");
     print_temp_info(temp->next);
-    dbg("\n");
-    dbg("}\n");
+    __log_dbg("\n");
+    __log_dbg("}\n");
 }
 
 void print_arena_info(const arena_t *arena) {
     if (arena != NULL) {
-        dbg("arena_t [%p]", arena);
+        __log_dbg("arena_t [%p]", arena);
     } else {
-        dbg("NULL");
+        __log_dbg("NULL");
     }
 }
 
 void print_temp_info(const arena_temp_t *temp) {
     if (temp != NULL) {
-        dbg("arena_temp_t [%p]", temp);
+        __log_dbg("arena_temp_t [%p]", temp);
     } else {
-        dbg("NULL");
+        __log_dbg("NULL");
     }
 }
 
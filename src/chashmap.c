@@ -0,0 +1,449 @@
+#define _GNU_SOURCE
+
+#include "chashmap.h"
+#include "hash.h"
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// The smallest table a map starts with.
+#define MIN_TABLE_LEN 16
+
+/// Key that marks a slot as never claimed. The actual
+/// key 0 is kept outside of the table, in `zero_val`.
+#define EMPTY_KEY 0
+
+/// A slot's key never changes once it has been claimed. A
+/// removed key stays behind with a NULL value, which lets a
+/// later insert of the same key reuse the slot.
+typedef struct {
+    _Atomic size_t key;
+    _Atomic(void *) val;
+} cslot_t;
+
+typedef struct table_t {
+    /// Number of slots, always a power of two.
+    size_t len;
+
+    /// Slots whose key has been claimed, including removed ones.
+    _Atomic size_t used;
+
+    /// Set when the table is replaced; see `__retire`.
+    uint64_t retired_epoch;
+    struct table_t *next_retired;
+
+    cslot_t slots[];
+} table_t;
+
+/// A thread that reads from any map. `epoch` holds the global
+/// epoch from when the thread started its current lookup, or 0
+/// while the thread isn't looking anything up. Records are shared
+/// by all maps, and reused by new threads once their thread exits.
+typedef struct reader_t {
+    _Atomic uint64_t epoch;
+    _Atomic int in_use;
+    struct reader_t *next;
+} reader_t;
+
+/// One epoch for all maps, so that a thread needs a single
+/// reader record and a single thread-specific key no matter
+/// how many maps it uses.
+static _Atomic uint64_t global_epoch = 1;
+static _Atomic(reader_t *) readers = NULL;
+static _Thread_local reader_t *local_reader = NULL;
+
+/// Hands the calling thread's record back when it exits.
+static pthread_key_t reader_key;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+static int reader_key_ok = 0;
+
+struct chashmap_t {
+    _Atomic(table_t *) table;
+    _Atomic(void *) zero_val;
+    _Atomic size_t size;
+    uint64_t seed;
+
+    /// Writers hold this shared; growing the table holds it exclusively.
+    pthread_rwlock_t resize_lock;
+
+    /// Replaced tables waiting to be freed. `num_retired` can be
+    /// read without the lock, to skip reclaiming when there is
+    /// nothing to reclaim.
+    pthread_mutex_t reclaim_lock;
+    table_t *retired;
+    _Atomic size_t num_retired;
+};
+
+
+// -------------------------------------------------
+// TABLE FUNCTIONS
+// -------------------------------------------------
+
+static inline size_t __hash(const chashmap_t *map, size_t key) {
+    return hash_u64(key, map->seed);
+}
+
+static table_t *__table_new(size_t len) {
+    table_t *table = calloc(1, sizeof(table_t) + sizeof(cslot_t) * len);
+    if (!table) {
+        __logln_err_fmt("Couldn't allocate hashmap table: %s", strerror(errno));
+        exit(1);
+    }
+    table->len = len;
+    return table;
+}
+
+/// Returns 1 if enough of the table's slots hold removed keys
+/// that it should be rebuilt, given that `live` keys are left.
+static inline int __table_is_sparse(table_t *table, size_t live) {
+    size_t used = atomic_load_explicit(&table->used, memory_order_relaxed);
+    return used > live && used - live >= table->len / 4;
+}
+
+/// Returns 1 if the table has to grow before another key is claimed.
+static inline int __table_is_full(table_t *table) {
+    size_t used = atomic_load_explicit(&table->used, memory_order_relaxed);
+    return used + 1 > table->len - table->len / 4;
+}
+
+static void *__table_get(table_t *table, size_t hash, size_t key) {
+    size_t mask = table->len - 1;
+    for (size_t i = 0, idx = hash & mask; i < table->len; i++, idx = (idx + 1) & mask) {
+        cslot_t *slot = table->slots + idx;
+        size_t slot_key = atomic_load_explicit(&slot->key, memory_order_acquire);
+        if (slot_key == key) {
+            return atomic_load_explicit(&slot->val, memory_order_acquire);
+        }
+        if (slot_key == EMPTY_KEY) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/// Returns the slot holding `key`, claiming an empty one if the
+/// key isn't in the table yet and `claim` is set. Returns NULL
+/// if the key isn't there and couldn't (or shouldn't) be claimed.
+static cslot_t *__table_find(table_t *table, size_t hash, size_t key, int claim) {
+    size_t mask = table->len - 1;
+    for (size_t i = 0, idx = hash & mask; i < table->len; i++, idx = (idx + 1) & mask) {
+        cslot_t *slot = table->slots + idx;
+        size_t slot_key = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+        if (slot_key == EMPTY_KEY) {
+            if (!claim) return NULL;
+            if (__table_is_full(table)) return NULL;
+            if (atomic_compare_exchange_strong(&slot->key, &slot_key, key)) {
+                atomic_fetch_add_explicit(&table->used, 1, memory_order_relaxed);
+                return slot;
+            }
+            // Lost the race for this slot, `slot_key` now holds the winner
+        }
+        if (slot_key == key) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+
+// -------------------------------------------------
+// EPOCH-BASED RECLAMATION
+// -------------------------------------------------
+
+static void __reader_release(void *ptr) {
+    reader_t *reader = ptr;
+    atomic_store(&reader->epoch, 0);
+    atomic_store(&reader->in_use, 0);
+    local_reader = NULL;
+}
+
+static void __reader_key_create(void) {
+    reader_key_ok = pthread_key_create(&reader_key, __reader_release) == 0;
+}
+
+/// Returns the calling thread's reader record, reusing the record
+/// of a thread that exited if there is one. Returns NULL if a
+/// record couldn't be allocated.
+static reader_t *__reader_get(void) {
+    reader_t *reader = local_reader;
+    if (reader != NULL) {
+        return reader;
+    }
+
+    (void)pthread_once(&reader_key_once, __reader_key_create);
+    if (!reader_key_ok) return NULL;
+
+    for (reader = atomic_load(&readers); reader != NULL; reader = reader->next) {
+        int unused = 0;
+        if (atomic_compare_exchange_strong(&reader->in_use, &unused, 1)) break;
+    }
+
+    if (reader == NULL) {
+        reader = malloc(sizeof(reader_t));
+        if (!reader) return NULL;
+        atomic_init(&reader->epoch, 0);
+        atomic_init(&reader->in_use, 1);
+        reader->next = atomic_load(&readers);
+        while (!atomic_compare_exchange_weak(&readers, &reader->next, reader)) {}
+    }
+
+    (void)pthread_setspecific(reader_key, reader);
+    local_reader = reader;
+    return reader;
+}
+
+/// Marks the start of a lookup. Tables replaced from now on are
+/// not freed until the matching `__reader_leave`.
+static inline void __reader_enter(reader_t *reader) {
+    atomic_store(&reader->epoch, atomic_load(&global_epoch));
+}
+
+static inline void __reader_leave(reader_t *reader) {
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+/// Frees every retired table that no reader can still see. A reader
+/// that entered at epoch E may hold any table retired at E or later.
+/// Must be called with `reclaim_lock` held.
+static void __reclaim(chashmap_t *map) {
+    uint64_t oldest = UINT64_MAX;
+    for (reader_t *reader = atomic_load(&readers); reader != NULL; reader = reader->next) {
+        uint64_t epoch = atomic_load(&reader->epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    table_t **link = &map->retired;
+    while (*link != NULL) {
+        table_t *table = *link;
+        if (table->retired_epoch < oldest) {
+            *link = table->next_retired;
+            free(table);
+            atomic_fetch_sub_explicit(&map->num_retired, 1, memory_order_relaxed);
+        } else {
+            link = &table->next_retired;
+        }
+    }
+}
+
+/// Queues a table that was just replaced to be freed, and frees any
+/// queued tables that readers are done with. The new table must
+/// already be published, so that readers entering the next epoch
+/// can't see the old one.
+static void __retire(chashmap_t *map, table_t *table) {
+    pthread_mutex_lock(&map->reclaim_lock);
+    table->retired_epoch = atomic_fetch_add(&global_epoch, 1);
+    table->next_retired = map->retired;
+    map->retired = table;
+    atomic_fetch_add_explicit(&map->num_retired, 1, memory_order_relaxed);
+    __reclaim(map);
+    pthread_mutex_unlock(&map->reclaim_lock);
+}
+
+/// Frees the retired tables that readers are done with, unless
+/// there are none or another thread is already freeing them.
+/// Cheap enough to call after every lookup.
+static inline void __try_reclaim(chashmap_t *map) {
+    if (atomic_load_explicit(&map->num_retired, memory_order_relaxed) == 0) return;
+    if (pthread_mutex_trylock(&map->reclaim_lock) != 0) return;
+    __reclaim(map);
+    pthread_mutex_unlock(&map->reclaim_lock);
+}
+
+
+// -------------------------------------------------
+// HASHMAP FUNCTION DEFINITIONS
+// -------------------------------------------------
+
+chashmap_t *chashmap_new(void) {
+    chashmap_t *map = malloc(sizeof(chashmap_t));
+    if (!map) {
+        __logln_err_fmt("Couldn't allocate new hashmap: %s", strerror(errno));
+        exit(1);
+    }
+
+    map->seed = hash_u64(time(0), (uintptr_t)map);
+    atomic_init(&map->table, __table_new(MIN_TABLE_LEN));
+    atomic_init(&map->zero_val, NULL);
+    atomic_init(&map->size, 0);
+    atomic_init(&map->num_retired, 0);
+    map->retired = NULL;
+
+    // Writers would otherwise starve a thread waiting to grow the table
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&map->resize_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    pthread_mutex_init(&map->reclaim_lock, NULL);
+    return map;
+}
+
+void chashmap_delete(chashmap_t *map, void (*val_free)(void *val)) {
+    if (!map) return;
+
+    table_t *table = atomic_load(&map->table);
+    if (val_free != NULL) {
+        void *zero_val = atomic_load(&map->zero_val);
+        if (zero_val != NULL) val_free(zero_val);
+
+        for (size_t i = 0; i < table->len; i++) {
+            void *val = atomic_load(&table->slots[i].val);
+            if (val != NULL) val_free(val);
+        }
+    }
+    free(table);
+
+    while (map->retired != NULL) {
+        table = map->retired;
+        map->retired = table->next_retired;
+        free(table);
+    }
+
+    pthread_mutex_destroy(&map->reclaim_lock);
+    pthread_rwlock_destroy(&map->resize_lock);
+    free(map);
+}
+
+/// Replaces `old` with a table sized for the keys currently in it,
+/// leaving removed keys behind, which grows a full table and
+/// shrinks a sparse one. Does nothing if another writer has
+/// replaced `old` already.
+static void __chashmap_rebuild(chashmap_t *map, table_t *old) {
+    pthread_rwlock_wrlock(&map->resize_lock);
+    if (atomic_load(&map->table) != old) {
+        pthread_rwlock_unlock(&map->resize_lock);
+        return;
+    }
+
+    // No writers are active, so `old` can't change under us.
+    // Size the new table so that it's at most a quarter full.
+    size_t live = 0;
+    for (size_t i = 0; i < old->len; i++) {
+        if (atomic_load_explicit(&old->slots[i].val, memory_order_relaxed) != NULL) live++;
+    }
+    size_t new_len = MIN_TABLE_LEN;
+    while (new_len < live * 4) {
+        new_len *= 2;
+    }
+
+    table_t *table = __table_new(new_len);
+    size_t mask = new_len - 1;
+    for (size_t i = 0; i < old->len; i++) {
+        size_t key = atomic_load_explicit(&old->slots[i].key, memory_order_relaxed);
+        void *val = atomic_load_explicit(&old->slots[i].val, memory_order_relaxed);
+        if (val == NULL) continue;
+
+        size_t idx = __hash(map, key) & mask;
+        while (atomic_load_explicit(&table->slots[idx].key, memory_order_relaxed) != EMPTY_KEY) {
+            idx = (idx + 1) & mask;
+        }
+        atomic_init(&table->slots[idx].key, key);
+        atomic_init(&table->slots[idx].val, val);
+    }
+    atomic_init(&table->used, live);
+
+    atomic_store(&map->table, table);
+    __retire(map, old);
+    pthread_rwlock_unlock(&map->resize_lock);
+}
+
+void *chashmap_get(chashmap_t *map, size_t key) {
+    if (!map) return NULL;
+    if (key == EMPTY_KEY) return atomic_load_explicit(&map->zero_val, memory_order_acquire);
+
+    size_t hash = __hash(map, key);
+    reader_t *reader = __reader_get();
+    if (reader == NULL) {
+        // No record to announce ourselves with,
+        // so keep the table from being replaced
+        pthread_rwlock_rdlock(&map->resize_lock);
+        void *val = __table_get(atomic_load(&map->table), hash, key);
+        pthread_rwlock_unlock(&map->resize_lock);
+        return val;
+    }
+
+    __reader_enter(reader);
+    void *val = __table_get(atomic_load(&map->table), hash, key);
+    __reader_leave(reader);
+
+    // Outside of the lookup, this thread holds no table back
+    __try_reclaim(map);
+    return val;
+}
+
+void *chashmap_insert(chashmap_t *map, size_t key, void *val) {
+    if (!map || !val) return NULL;
+
+    void *old;
+    if (key == EMPTY_KEY) {
+        old = atomic_exchange(&map->zero_val, val);
+    } else {
+        size_t hash = __hash(map, key);
+        for (;;) {
+            pthread_rwlock_rdlock(&map->resize_lock);
+            table_t *table = atomic_load(&map->table);
+            cslot_t *slot = __table_find(table, hash, key, 1);
+            if (slot != NULL) {
+                old = atomic_exchange(&slot->val, val);
+                pthread_rwlock_unlock(&map->resize_lock);
+                break;
+            }
+            pthread_rwlock_unlock(&map->resize_lock);
+
+            __chashmap_rebuild(map, table); // EXPENSIVE
+        }
+    }
+
+    if (old == NULL) {
+        atomic_fetch_add_explicit(&map->size, 1, memory_order_relaxed);
+    }
+    return old;
+}
+
+void *chashmap_remove(chashmap_t *map, size_t key) {
+    if (!map) return NULL;
+
+    if (key == EMPTY_KEY) {
+        void *old = atomic_exchange(&map->zero_val, NULL);
+        if (old != NULL) {
+            atomic_fetch_sub_explicit(&map->size, 1, memory_order_relaxed);
+        }
+        return old;
+    }
+
+    pthread_rwlock_rdlock(&map->resize_lock);
+    table_t *table = atomic_load(&map->table);
+    cslot_t *slot = __table_find(table, __hash(map, key), key, 0);
+    void *old = (slot != NULL) ? atomic_exchange(&slot->val, NULL) : NULL;
+    int sparse = 0;
+    if (old != NULL) {
+        size_t live = atomic_fetch_sub_explicit(&map->size, 1, memory_order_relaxed) - 1;
+        // Only decided while holding the lock, since
+        // `table` may be freed as soon as it's released
+        sparse = __table_is_sparse(table, live);
+    }
+    pthread_rwlock_unlock(&map->resize_lock);
+
+    if (sparse) {
+        // Removed keys only go away when the table is rebuilt,
+        // which a map that stops growing would never do
+        __chashmap_rebuild(map, table); // EXPENSIVE
+    } else {
+        __try_reclaim(map);
+    }
+    return old;
+}
+
+size_t chashmap_len(chashmap_t *map) {
+    return (map) ? atomic_load_explicit(&map->size, memory_order_relaxed) : 0;
+}
@@ -0,0 +1,85 @@
+#ifndef __GROUP_H
+#define __GROUP_H
+
+// Control bytes shared by the open-addressing tables. Each
+// slot of a table has one control byte that is either
+// CTRL_EMPTY, CTRL_DELETED, or (when full) the low 7 bits
+// of its key's hash, and a group of GROUP_WIDTH control
+// bytes is compared against a tag all at once.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Number of control bytes that are probed at once,
+/// which is the width of one SSE2 register.
+#define GROUP_WIDTH 16
+
+/// Control byte of a slot that has never held a pair.
+#define CTRL_EMPTY ((int8_t)-128)
+
+/// Control byte of a slot whose pair was removed. Probing
+/// continues past these, but insertion may reuse them.
+#define CTRL_DELETED ((int8_t)-2)
+
+/// One bit per slot of a group, lowest bit being the first slot.
+typedef uint32_t bitmask_t;
+
+#ifdef __SSE2__
+
+static inline bitmask_t __group_match(const int8_t *group, int8_t tag) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (bitmask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl));
+}
+
+static inline bitmask_t __group_match_empty(const int8_t *group) {
+    return __group_match(group, CTRL_EMPTY);
+}
+
+static inline bitmask_t __group_match_empty_or_deleted(const int8_t *group) {
+    // Both special bytes are less than -1, full bytes never are
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (bitmask_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+}
+
+#else
+
+static inline bitmask_t __group_match(const int8_t *group, int8_t tag) {
+    bitmask_t mask = 0;
+    for (size_t i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (bitmask_t)(group[i] == tag) << i;
+    }
+    return mask;
+}
+
+static inline bitmask_t __group_match_empty(const int8_t *group) {
+    return __group_match(group, CTRL_EMPTY);
+}
+
+static inline bitmask_t __group_match_empty_or_deleted(const int8_t *group) {
+    bitmask_t mask = 0;
+    for (size_t i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (bitmask_t)(group[i] < -1) << i;
+    }
+    return mask;
+}
+
+#endif
+
+/// Pops the lowest set bit of `mask` and returns its position.
+static inline size_t __bitmask_next(bitmask_t *mask) {
+    size_t i = (size_t)__builtin_ctz(*mask);
+    *mask &= *mask - 1;
+    return i;
+}
+
+/// The number of slots that may be filled before a
+/// table has to grow, which caps the load at 7/8.
+static inline size_t __group_capacity(size_t len) {
+    return len - len / 8;
+}
+
+#endif // __GROUP_H
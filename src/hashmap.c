@@ -1,6 +1,9 @@
 #include "hashmap.h"
+#include "group.h"
+#include "hash.h"
 #include "log.h"
 
+#include <assert.h>
 #include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -10,330 +13,820 @@
 
 #define __TRUE 1
 #define __FALSE 0
-#define __CEILING 4
+
+/// The fewest groups of the old container each insert or remove
+/// migrates while an incremental rehash is underway. Large old
+/// containers migrate more per operation, see `__hashmap_rehash`.
+#ifndef HASHMAP_MIGRATE_GROUPS
+#define HASHMAP_MIGRATE_GROUPS 8
+#endif
+
+/// How many keys `hashmap_get_many` has in flight at once.
+/// Enough to cover memory latency, few enough that the lines
+/// it prefetches are still cached when it comes back to them.
+#ifndef HASHMAP_BATCH
+#define HASHMAP_BATCH 32
+#endif
 
 typedef struct {
     size_t key;
     void *val;
 } kv_t;
 
-typedef struct {
-    size_t len;
-    size_t cap;
-    kv_t *pairs;
-} bucket_t;
-
+/// A flat index of `len` slots. Each slot has a control
+/// byte in `ctrl` that is either CTRL_EMPTY, CTRL_DELETED,
+/// or (when full) the low 7 bits of its key's hash. A full
+/// slot holds the position of its pair in the map's `entries`.
+/// Lookups compare those tags a whole group at a time and only
+/// touch `slots` and the entries on a tag match.
+///
+/// `len` is zero or a power of two that is at least GROUP_WIDTH.
 typedef struct {
     size_t size;
     size_t len;
-    bucket_t *buf;
+    size_t growth_left;
+    int8_t *ctrl;
+    size_t *slots;
 } container_t;
 
 struct hashmap_t {
-    int seed;
+    uint64_t seed;
+    int flags;
+
+    /// The map's custom hash function, or NULL for `hash_u64`.
+    uint64_t (*hash)(size_t key, uint64_t seed);
+
+    /// Every pair in the map, packed at the front in insertion
+    /// order. Removing a pair moves the last one into its place.
+    kv_t *entries;
+    size_t num_entries;
+    size_t entries_cap;
+
+    /// The entries an incremental rehash is copying into a
+    /// larger `entries`, a batch per operation, so that growing
+    /// them never copies every pair at once. The pairs at
+    /// positions [entries_moved, old_entries_len) are still
+    /// only in `old_entries`.
+    kv_t *old_entries;
+    size_t old_entries_len;
+    size_t old_entries_cap;
+    size_t entries_moved;
+
+    /// The capacity the map was last asked to reserve, which
+    /// removes never shrink it below.
+    size_t reserved;
+
     container_t buckets;
+
+    /// The container being migrated into `buckets` by an
+    /// incremental rehash, or an unallocated one if there's
+    /// no rehash underway. Groups below `migrated` have
+    /// been moved already. Only the index is migrated, since
+    /// both containers point into the same entries.
+    container_t old_buckets;
+    size_t migrated;
+
+    /// How many groups each operation migrates, enough that the
+    /// old container is empty before the new one can fill up.
+    size_t migrate_groups;
+
+    /// Where the map, its entries, and every container
+    /// it ever has, are allocated from.
+    allocator alloc;
 };
 
 // ----------------------------------------------------
-// Murmur3 32-bit Hash Algorithm
+// Container Functions
 // ----------------------------------------------------
 
-static inline uint32_t murmur_32_scramble(uint32_t k) {
-    k *= 0xcc9e2d51;
-    k = (k << 15) | (k >> 17);
-    k *= 0x1b873593;
-    return k;
-}
-
-uint32_t murmur3_32(const uint8_t *key, size_t len, uint32_t seed) {
-    uint32_t h = seed;
-    uint32_t k;
-
-    /* Read in groups of 4. */
-    for (size_t i = len >> 2; i; i--) {
-        // Here is a source of differing results across endiannesses.
-        // A swap here has no effects on hash properties though.
-        (void)memcpy(&k, key, sizeof(uint32_t));
-        key += sizeof(uint32_t);
-        h ^= murmur_32_scramble(k);
-        h = (h << 13) | (h >> 19);
-        h = h * 5 + 0xe6546b64;
+/// Returns the pair at `position`, wherever it lives
+/// while an incremental rehash is underway.
+static inline kv_t *__hashmap_entry(const hashmap_t *map, size_t position) {
+    if (position >= map->entries_moved && position < map->old_entries_len) {
+        return map->old_entries + position;
     }
+    return map->entries + position;
+}
 
-    /* Read the rest. */
-    k = 0;
-    for (size_t i = len & 3; i; i--) {
-        k <<= 8;
-        k |= key[i - 1];
+/// Allocates an empty container with `len` slots. The
+/// slots and their control bytes share one allocation.
+static container_t __container_new(const allocator *alloc, size_t len) {
+    size_t len_u8 = (sizeof(size_t) + sizeof(int8_t)) * len;
+    void *new_ptr = alloc->alloc(alloc->ctx, len_u8);
+    if (!new_ptr) {
+        __logln_err_fmt("Container couldn't be allocated: %s", strerror(errno));
+        exit(1);
     }
 
-    // A swap is *not* necessary here because the preceding loop already
-    // places the low bytes in the low places according to whatever
-    // endianness we use. Swaps only apply when the memory is copied in a chunk.
-    h ^= murmur_32_scramble(k);
+    size_t *slots = new_ptr;
+    int8_t *ctrl = (int8_t *)(slots + len);
+    (void)memset(ctrl, CTRL_EMPTY, len);
 
-    /* Finalize. */
-    h ^= len;
-    h ^= h >> 16;
-    h *= 0x85ebca6b;
-    h ^= h >> 13;
-    h *= 0xc2b2ae35;
-    h ^= h >> 16;
-    return h;
+    return (container_t) {
+        .size = 0,
+        .len = len,
+        .growth_left = __group_capacity(len),
+        .ctrl = ctrl,
+        .slots = slots
+    };
 }
 
-// ----------------------------------------------------
-// Vector/Bucket Functions
-// ----------------------------------------------------
-
-inline int key_eq(kv_t *left, kv_t *right) {
-    return left->key == right->key;
-}
+/// Frees the container. The pairs it indexes live
+/// in the map's entries, so they're left untouched.
+static void __container_delete(const allocator *alloc, container_t *container) {
+    if (!container) return;
 
-inline size_t max(size_t left, size_t right) {
-    if (left >= right) {
-        return left;
+    if (container->slots != NULL) {
+        alloc->free(alloc->ctx, container->slots);
     }
-    return right;
-}
-
-static void __bucket_reserve(bucket_t *bucket, size_t len) {
-    size_t new_cap = bucket->len + 1;
 
-    new_cap = max(bucket->cap * 2, new_cap);
-    new_cap = max(__CEILING, new_cap);
+    (*container) = (container_t) {0};
+}
 
-    void *new_ptr = realloc(bucket->pairs, sizeof(kv_t) * new_cap);
-    if (!new_ptr) {
-        __logln_err_fmt("Bucket couldn't be reallocated: %s", strerror(errno));
-        exit(1);
+/// Returns the index of the first slot along `hash`'s probe
+/// sequence that is either empty or deleted. The container must
+/// have been allocated, and always has an empty slot somewhere.
+static size_t __container_find_insert_slot(const container_t *container, uint64_t hash) {
+    size_t group_mask = container->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    // Triangular probing visits every group once
+    // since the group count is a power of two.
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        bitmask_t free_slots = __group_match_empty_or_deleted(container->ctrl + base);
+        if (free_slots != 0) {
+            return base + __bitmask_next(&free_slots);
+        }
+        group = (group + step) & group_mask;
     }
-    bucket->pairs = new_ptr;
-    bucket->cap = new_cap;
 }
 
-void *bucket_remove(bucket_t *bucket, size_t idx) {
-    if (bucket == NULL || idx >= bucket->len) return NULL;
-    kv_t *ptr = bucket->pairs + (uintptr_t)idx;
-    void *ret = ptr->val;
-    (void)memmove(ptr, ptr + 1, bucket->len - idx - 1);
-    bucket->len--;
-    return ret;
-}
+/// Returns the index of the first full slot along `hash`'s probe
+/// sequence that matches `needle`, or `container->len` if there's
+/// none. A slot matches if its entry's key is `needle`, or if
+/// `by_position` is set, if the entry's position is `needle`.
+static inline size_t __container_probe(const hashmap_t *map, const container_t *container,
+                                       uint64_t hash, size_t needle, int by_position) {
+    if (container->len == 0) return container->len;
+
+    size_t group_mask = container->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    int8_t tag = (int8_t)(hash & 0x7f);
+
+    // Every group has been probed once the step passes the group
+    // count. That only happens in a container with no empty
+    // slots left, i.e. one an incremental rehash is emptying.
+    for (size_t step = 1; step <= group_mask + 1; step++) {
+        size_t base = group * GROUP_WIDTH;
+        const int8_t *ctrl = container->ctrl + base;
+
+        bitmask_t candidates = __group_match(ctrl, tag);
+        while (candidates != 0) {
+            size_t i = base + __bitmask_next(&candidates);
+            size_t position = container->slots[i];
+            if (by_position ? position == needle : __hashmap_entry(map, position)->key == needle) {
+                return i;
+            }
+        }
 
-void bucket_push(bucket_t *bucket, kv_t kv) {
-    if (bucket->len == bucket->cap) {
-        __bucket_reserve(bucket, bucket->len);
+        // An empty slot means the key was never
+        // pushed further along its probe sequence
+        if (__group_match_empty(ctrl) != 0) {
+            return container->len;
+        }
+        group = (group + step) & group_mask;
     }
-
-    kv_t *end = bucket->pairs + (uintptr_t) bucket->len;
-    (*end) = kv;
-    bucket->len++;
+    return container->len;
 }
 
-/// Creates a new empty container table that has double the
-/// length of the container that was passed in.
-///
-/// Does nothing to the original container. Returns a
-/// container struct with the parameters of the grown table,
-/// with the buffer already allocated.
-/// Note that the bucket's buffers have not been allocated,
-/// and their lengths and capacities have been set to zero.
-/// That is so the user can rehash the old containers elements
-/// and add them to the new bucket however they choose.
-static container_t __container_grow(const container_t *container) {
-    size_t new_len = container->len + 1;
-    new_len = max(container->len * 2, new_len);
-    new_len = max(__CEILING, new_len);
-
-    size_t new_len_u8 = sizeof(bucket_t) * new_len;
-    void *new_ptr = malloc(new_len_u8);
-    if (!new_ptr) {
-        __logln_err_fmt("Container couldn't be reallocated: %s", strerror(errno));
-        exit(1);
-    }
-    (void)memset(new_ptr, 0, new_len_u8);
-
-    return (container_t) {
-        .size = container->size,
-        .len = new_len,
-        .buf = new_ptr
-    };
+/// Returns the index of the slot holding `key`, or `container->len`
+/// if the key is not in the container.
+static size_t __container_find(const hashmap_t *map, const container_t *container,
+                               uint64_t hash, size_t key) {
+    return __container_probe(map, container, hash, key, __FALSE);
 }
 
-/// Frees the container and the underlying buckets, but
-/// purposely forgets to free the memory of the values
-/// within the key/value pairs. Use if rehashing, or
-/// if the container is already empty.
-static void __container_delete_nofree(container_t *container) {
-    if (!container) return;
+/// Returns the index of the slot pointing at entry `position`,
+/// whose key hashes to `hash`, or `container->len` if there's none.
+static size_t __container_find_position(const container_t *container, uint64_t hash,
+                                        size_t position) {
+    return __container_probe(NULL, container, hash, position, __TRUE);
+}
 
-    for (size_t i = 0; i < container->len; i++) {
-        bucket_t *bucket = container->buf + i;
-        if (bucket->cap == 0) continue;
-        free(bucket->pairs);
+/// Points slot `i` at entry `position`, tagged by its hash.
+static inline void __container_set(container_t *container, size_t i, uint64_t hash,
+                                   size_t position) {
+    if (container->ctrl[i] == CTRL_EMPTY) {
+        container->growth_left--;
     }
-    free(container->buf);
-
-    (*container) = (container_t) {
-        .size = 0,
-        .len = 0,
-        .buf = NULL
-    };
+    container->ctrl[i] = (int8_t)(hash & 0x7f);
+    container->slots[i] = position;
+    container->size++;
 }
 
-/// Same as `__container_delete_nofree`, but iterates through each bucket
-/// and calls `val_free` on each value from the key/value pair.
-static void __container_delete_andfree(container_t *container, void (*val_free)(void *val)) {
-    if (!container) return;
-
-    for (size_t i = 0; i < container->len; i++) {
-        bucket_t *bucket = container->buf + i;
-        if (bucket->cap == 0) continue;
-        for (size_t j = 0; j < bucket->len; j++) {
-            val_free(bucket->pairs[j].val);
-        }
-        free(bucket->pairs);
+/// Empties slot `i`.
+static void __container_remove(container_t *container, size_t i) {
+    // If this slot's group still has an empty slot, no probe
+    // sequence ever continued past it, so the slot can become
+    // empty again instead of leaving a tombstone behind.
+    size_t base = i & ~(size_t)(GROUP_WIDTH - 1);
+    if (__group_match_empty(container->ctrl + base) != 0) {
+        container->ctrl[i] = CTRL_EMPTY;
+        container->growth_left++;
+    } else {
+        container->ctrl[i] = CTRL_DELETED;
     }
-    free(container->buf);
-
-    (*container) = (container_t) {
-        .size = 0,
-        .len = 0,
-        .buf = NULL
-    };
+    container->size--;
 }
 
-
 // ----------------------------------------------------
 // Hashmap Function Definitions
 // ----------------------------------------------------
 
-size_t __calc_index(uint32_t seed, size_t key, size_t len) {
-    size_t hashed_key = murmur3_32(
-        (const uint8_t *)&key,
-        sizeof(size_t),
-        seed
-    );
-
-    // Determine bucket to insert key/value pair
-    size_t index = hashed_key % len;
-    return index;
+/// The low 7 bits of the hash become the key's tag, and the
+/// bits above pick its first group, so tables can keep growing
+/// well past 2^32 slots without running out of hash bits.
+static inline uint64_t __hash(const hashmap_t *map, size_t key) {
+    // Calling the default directly lets it be inlined
+    if (map->hash == NULL) {
+        return hash_u64(key, map->seed);
+    }
+    return map->hash(key, map->seed);
 }
 
 hashmap_t *hashmap_new(void) {
-    hashmap_t *map = malloc(sizeof(hashmap_t));
+    return hashmap_new_with(NULL);
+}
+
+hashmap_t *hashmap_new_with(const hashmap_config_t *config) {
+    allocator alloc = heap_allocator();
+    if (config != NULL && config->alloc.alloc != NULL) {
+        alloc = config->alloc;
+    }
+
+    hashmap_t *map = alloc.alloc(alloc.ctx, sizeof(hashmap_t));
     if (!map) {
         __logln_err_fmt("Couldn't allocate new hashmap: %s", strerror(errno));
         exit(1);
     }
 
     (*map) = (hashmap_t) {
-        .seed = time(0),
-        .buckets = {0}
+        .seed = hash_u64(time(0), (uintptr_t)map),
+        .flags = (config != NULL) ? config->flags : 0,
+        .hash = (config != NULL) ? config->hash : NULL,
+        .entries = NULL,
+        .num_entries = 0,
+        .entries_cap = 0,
+        .old_entries = NULL,
+        .old_entries_len = 0,
+        .old_entries_cap = 0,
+        .entries_moved = 0,
+        .reserved = 0,
+        .buckets = {0},
+        .old_buckets = {0},
+        .migrated = 0,
+        .alloc = alloc
     };
 
+    if (config != NULL && config->capacity != 0) {
+        hashmap_reserve(map, config->capacity);
+    }
+
     return map;
 }
 
+hashmap_t *hashmap_with_capacity(size_t capacity) {
+    hashmap_config_t config = {.capacity = capacity};
+    return hashmap_new_with(&config);
+}
+
 void hashmap_delete(hashmap_t *map, void (*val_free)(void *val)) {
     if (!map) return;
+
     if (val_free != NULL) {
-        __container_delete_andfree(&map->buckets, val_free);
+        for (size_t i = 0; i < map->num_entries; i++) {
+            val_free(__hashmap_entry(map, i)->val);
+        }
+    }
+
+    // The map is about to free itself, so
+    // its allocator has to outlive it
+    allocator alloc = map->alloc;
+    if (map->entries != NULL) {
+        alloc.free(alloc.ctx, map->entries);
+    }
+    if (map->old_entries != NULL) {
+        alloc.free(alloc.ctx, map->old_entries);
+    }
+    __container_delete(&alloc, &map->buckets);
+    __container_delete(&alloc, &map->old_buckets);
+    alloc.free(alloc.ctx, map);
+}
+
+/// Resizes the entries to hold `cap` pairs, using the allocator's
+/// `realloc` if it has one, which may avoid copying them.
+static void __hashmap_resize_entries(hashmap_t *map, size_t cap) {
+    const allocator *alloc = &map->alloc;
+    size_t old_u8 = sizeof(kv_t) * map->entries_cap;
+    size_t new_u8 = sizeof(kv_t) * cap;
+
+    kv_t *entries = NULL;
+    if (map->entries == NULL) {
+        entries = alloc->alloc(alloc->ctx, new_u8);
+    } else if (alloc->realloc != NULL) {
+        entries = alloc->realloc(alloc->ctx, map->entries, old_u8, new_u8);
     } else {
-        __container_delete_nofree(&map->buckets);
+        entries = alloc->alloc(alloc->ctx, new_u8);
+        if (entries != NULL) {
+            (void)memcpy(entries, map->entries, sizeof(kv_t) * map->num_entries);
+            alloc->free(alloc->ctx, map->entries);
+        }
     }
-    free(map);
+    if (!entries) {
+        __logln_err_fmt("Entries couldn't be reallocated: %s", strerror(errno));
+        exit(1);
+    }
+
+    map->entries = entries;
+    map->entries_cap = cap;
 }
 
-static void __hashmap_rehash(hashmap_t *map) {
-    container_t new_buckets = __container_grow(&map->buckets);
+/// Copies up to `count` more pairs out of the old entries,
+/// and frees them once they've all been copied.
+static void __hashmap_migrate_entries(hashmap_t *map, size_t count) {
+    // Removes may have dropped pairs that were never copied
+    size_t left = 0;
+    if (map->old_entries_len > map->entries_moved) {
+        left = map->old_entries_len - map->entries_moved;
+    }
+    if (count > left) {
+        count = left;
+    }
+
+    (void)memcpy(map->entries + map->entries_moved, map->old_entries + map->entries_moved,
+                 sizeof(kv_t) * count);
+    map->entries_moved += count;
+
+    if (count == left) {
+        map->alloc.free(map->alloc.ctx, map->old_entries);
+        map->old_entries = NULL;
+        map->old_entries_len = 0;
+        map->old_entries_cap = 0;
+        map->entries_moved = 0;
+    }
+}
+
+/// Moves the slots of up to `groups` more groups of the old
+/// container into the new one, and frees the old container
+/// once it's empty. Migrated slots are marked deleted rather
+/// than empty, so that probes for pairs that are still in the
+/// old container keep going past them.
+static void __hashmap_migrate(hashmap_t *map, const size_t groups) {
+    container_t *old = &map->old_buckets;
+    size_t num_groups = old->len / GROUP_WIDTH;
+
+    for (size_t n = groups; n > 0 && map->migrated < num_groups && old->size > 0; n--) {
+        size_t base = map->migrated * GROUP_WIDTH;
+        for (size_t i = base; i < base + GROUP_WIDTH; i++) {
+            if (old->ctrl[i] < 0) continue;
+            size_t position = old->slots[i];
+            uint64_t hash = __hash(map, __hashmap_entry(map, position)->key);
+            size_t index = __container_find_insert_slot(&map->buckets, hash);
+            __container_set(&map->buckets, index, hash, position);
+            old->ctrl[i] = CTRL_DELETED;
+            old->size--;
+        }
+        map->migrated++;
+    }
+
+    if (old->size == 0) {
+        __container_delete(&map->alloc, old);
+        map->migrated = 0;
+    }
+
+    if (map->old_entries != NULL) {
+        __hashmap_migrate_entries(map, (groups == SIZE_MAX) ? SIZE_MAX : groups * GROUP_WIDTH);
+    }
+}
+
+/// Whether an incremental rehash is underway.
+static inline int __hashmap_migrating(const hashmap_t *map) {
+    return map->old_buckets.len != 0 || map->old_entries != NULL;
+}
+
+/// Does one operation's share of an incremental rehash.
+static inline void __hashmap_migrate_step(hashmap_t *map) {
+    if (__hashmap_migrating(map)) {
+        __hashmap_migrate(map, map->migrate_groups);
+    }
+}
 
-    for (size_t i = 0; i < map->buckets.len; i++) {
-        bucket_t *bucket = map->buckets.buf + i;
-        if (bucket->cap == 0) continue;
-        for (size_t j = 0; j < bucket->len; j++) {
-            kv_t *pair = bucket->pairs + j;
+/// Moves every pair's slot into a new container, the smallest one
+/// that can hold at least `min_size` pairs, and makes room for that
+/// many entries. With HASHMAP_INCREMENTAL_REHASH the slots are moved
+/// by later operations instead.
+static void __hashmap_rehash(hashmap_t *map, size_t min_size) {
+    size_t new_len = GROUP_WIDTH;
+    while (__group_capacity(new_len) < min_size) {
+        new_len *= 2;
+    }
 
-            // Determine bucket to insert key/value pair
-            size_t index = __calc_index(map->seed, pair->key, map->buckets.len);
-            bucket_t *new_bucket = new_buckets.buf + index;
+    int incremental = (map->flags & HASHMAP_INCREMENTAL_REHASH) && map->buckets.size > 0;
+
+    if (map->entries_cap > __group_capacity(new_len)) {
+        // Shrinking, which allocators can usually do in place
+        __hashmap_resize_entries(map, __group_capacity(new_len));
+    } else if (map->entries_cap < __group_capacity(new_len)) {
+        if (incremental) {
+            kv_t *entries = map->alloc.alloc(map->alloc.ctx, sizeof(kv_t) * __group_capacity(new_len));
+            if (!entries) {
+                __logln_err_fmt("Entries couldn't be allocated: %s", strerror(errno));
+                exit(1);
+            }
+            map->old_entries = map->entries;
+            map->old_entries_len = map->num_entries;
+            map->old_entries_cap = map->entries_cap;
+            map->entries_moved = 0;
+            map->entries = entries;
+            map->entries_cap = __group_capacity(new_len);
+        } else {
+            __hashmap_resize_entries(map, __group_capacity(new_len));
+        }
+    }
 
-            // Note: This will incur a new allocation
-            // for every new bucket we push a pair into.
-            // It might be nice to allocate memory for each
-            // bucket ahead of time, but currently idk how.
-            bucket_push(new_bucket, *pair);
+    container_t new_buckets = __container_new(&map->alloc, new_len);
+
+    if (incremental) {
+        // Each slot moved over and each pair inserted takes up one
+        // of the new container's empty slots, and each insert does
+        // a step first, so `headroom` more steps always come before
+        // it fills. Spreading the old groups over that many steps
+        // means a grow never finds the last rehash still underway.
+        size_t old_groups = map->buckets.len / GROUP_WIDTH;
+        size_t headroom = 1;
+        if (new_buckets.growth_left > map->buckets.size) {
+            headroom = new_buckets.growth_left - map->buckets.size;
+        }
+        map->migrate_groups = (old_groups + headroom - 1) / headroom;
+        if (map->migrate_groups < HASHMAP_MIGRATE_GROUPS) {
+            map->migrate_groups = HASHMAP_MIGRATE_GROUPS;
         }
+
+        map->old_buckets = map->buckets;
+        map->buckets = new_buckets;
+        map->migrated = 0;
+        __hashmap_migrate_step(map);
+        return;
+    }
+
+    // The entries are already packed, so
+    // this rebuilds the index in one pass
+    for (size_t i = 0; i < map->num_entries; i++) {
+        uint64_t hash = __hash(map, __hashmap_entry(map, i)->key);
+        size_t index = __container_find_insert_slot(&new_buckets, hash);
+        __container_set(&new_buckets, index, hash, i);
     }
 
     // Delete old container
-    __container_delete_nofree(&map->buckets);
+    __container_delete(&map->alloc, &map->buckets);
 
     // Replace with new container
     map->buckets = new_buckets;
 }
 
+/// Called when the container has run out of empty slots. Doubles
+/// the container if the pairs fill more than half of it, otherwise
+/// it's mostly deleted slots, so rehash into the same length.
+static void __hashmap_grow(hashmap_t *map) {
+    // Only one rehash can be underway at a time, and the step
+    // size picked by `__hashmap_rehash` finishes it before this
+    assert(!__hashmap_migrating(map));
+
+    size_t capacity = __group_capacity(map->buckets.len);
+    if (map->buckets.size >= capacity / 2) {
+        __hashmap_rehash(map, capacity + 1);
+    } else {
+        __hashmap_rehash(map, capacity);
+    }
+}
+
+/// Shrinks the map once removes have left it less than 1/8 full,
+/// down to a table that's about half full. Growing only happens
+/// at 7/8 full, so a map that hovers around one size never
+/// keeps growing and shrinking.
+static void __hashmap_maybe_shrink(hashmap_t *map) {
+    size_t capacity = __group_capacity(map->buckets.len);
+    if ((map->flags & HASHMAP_NO_AUTO_SHRINK)
+        || map->buckets.len <= GROUP_WIDTH
+        || map->num_entries >= capacity / 8
+        || capacity / 2 <= map->reserved
+        || __hashmap_migrating(map)) {
+        return;
+    }
+
+    size_t min_size = map->num_entries * 2;
+    __hashmap_rehash(map, (min_size > map->reserved) ? min_size : map->reserved);
+}
+
+/// Returns the container and slot index holding `key`,
+/// or NULL if the key is not in the map.
+static container_t *__hashmap_find(hashmap_t *map, uint64_t hash, size_t key, size_t *index) {
+    *index = __container_find(map, &map->buckets, hash, key);
+    if (*index != map->buckets.len) {
+        return &map->buckets;
+    }
+
+    if (map->old_buckets.len != 0) {
+        *index = __container_find(map, &map->old_buckets, hash, key);
+        if (*index != map->old_buckets.len) {
+            return &map->old_buckets;
+        }
+    }
+    return NULL;
+}
+
 void *hashmap_get(hashmap_t *map, size_t key) {
-    if (!map || !map->buckets.buf) return NULL;
-
-    // Determine bucket to locate key/value pair
-    size_t index = __calc_index(map->seed, key, map->buckets.len);
-    bucket_t *bucket = map->buckets.buf + index;
-
-    // Linearly search for matching key, if it exists
-    if (bucket->cap == 0) return NULL;
-    for (size_t i = 0; i < bucket->len; i++) {
-        kv_t *pair = bucket->pairs + i;
-        if (pair->key == key) {
-            return pair->val;
+    if (!map) return NULL;
+
+    size_t i;
+    container_t *container = __hashmap_find(map, __hash(map, key), key, &i);
+    if (container == NULL) return NULL;
+
+    return __hashmap_entry(map, container->slots[i])->val;
+}
+
+size_t hashmap_get_many(hashmap_t *map, const size_t *keys, size_t n, void **out_vals) {
+    if (!map) return 0;
+    if (map->buckets.len == 0) {
+        (void)memset(out_vals, 0, sizeof(void *) * n);
+        return 0;
+    }
+
+    uint64_t hashes[HASHMAP_BATCH];
+    size_t found = 0;
+    const container_t *buckets = &map->buckets;
+    size_t group_mask = buckets->len / GROUP_WIDTH - 1;
+
+    for (size_t start = 0; start < n; start += HASHMAP_BATCH) {
+        size_t batch = (n - start < HASHMAP_BATCH) ? n - start : HASHMAP_BATCH;
+
+        // Hash every key, and start loading the first group each
+        // one probes. Most keys are found in that group.
+        for (size_t i = 0; i < batch; i++) {
+            hashes[i] = __hash(map, keys[start + i]);
+            size_t base = ((hashes[i] >> 7) & group_mask) * GROUP_WIDTH;
+            __builtin_prefetch(buckets->ctrl + base);
+            __builtin_prefetch(buckets->slots + base);
+        }
+
+        // By now the groups have arrived, so start loading
+        // the entry of each key's first tag match
+        for (size_t i = 0; i < batch; i++) {
+            size_t base = ((hashes[i] >> 7) & group_mask) * GROUP_WIDTH;
+            bitmask_t candidates = __group_match(buckets->ctrl + base, (int8_t)(hashes[i] & 0x7f));
+            if (candidates != 0) {
+                size_t position = buckets->slots[base + __bitmask_next(&candidates)];
+                __builtin_prefetch(__hashmap_entry(map, position));
+            }
+        }
+
+        // Everything a lookup touches should be cached now
+        for (size_t i = 0; i < batch; i++) {
+            size_t index;
+            container_t *container = __hashmap_find(map, hashes[i], keys[start + i], &index);
+            if (container != NULL) {
+                out_vals[start + i] = __hashmap_entry(map, container->slots[index])->val;
+                found++;
+            } else {
+                out_vals[start + i] = NULL;
+            }
         }
     }
 
-    // Key not found
-    return NULL;
+    return found;
+}
+
+/// Appends a pair for `key`, which must not be in the map yet,
+/// and indexes it by `hash`. Returns the pair's position.
+static size_t __hashmap_push(hashmap_t *map, uint64_t hash, size_t key, void *val) {
+    if (map->buckets.len == 0) {
+        __hashmap_grow(map);
+    }
+
+    size_t index = __container_find_insert_slot(&map->buckets, hash);
+    if ((map->buckets.ctrl[index] == CTRL_EMPTY && map->buckets.growth_left == 0)
+        || map->num_entries == map->entries_cap) {
+        __hashmap_grow(map); // EXPENSIVE
+        index = __container_find_insert_slot(&map->buckets, hash);
+    }
+
+    size_t position = map->num_entries++;
+    map->entries[position] = (kv_t) {.key = key, .val = val};
+    __container_set(&map->buckets, index, hash, position);
+
+    return position;
 }
 
 int hashmap_insert(hashmap_t *map, size_t key, void *val) {
     if (!map) return __FALSE;
 
-    // Get bucket from hashed key
-    if (map->buckets.len <= map->buckets.size * 4) {
-        __hashmap_rehash(map); // EXPENSIVE
+    uint64_t hash = __hash(map, key);
+    __hashmap_migrate_step(map);
+    (void)__hashmap_push(map, hash, key, val);
+
+    return __TRUE;
+}
+
+void **hashmap_entry(hashmap_t *map, size_t key, int *inserted) {
+    if (!map) return NULL;
+
+    uint64_t hash = __hash(map, key);
+    __hashmap_migrate_step(map);
+
+    size_t i;
+    container_t *container = __hashmap_find(map, hash, key, &i);
+    if (container != NULL) {
+        if (inserted != NULL) *inserted = __FALSE;
+        return &__hashmap_entry(map, container->slots[i])->val;
     }
 
-    // Determine bucket to insert key/value pair
-    size_t index = __calc_index(map->seed, key, map->buckets.len);
-    bucket_t *bucket = map->buckets.buf + index;
-    bucket_push(bucket, (kv_t) {.key = key, .val = val});
+    size_t position = __hashmap_push(map, hash, key, NULL);
+    if (inserted != NULL) *inserted = __TRUE;
+    return &__hashmap_entry(map, position)->val;
+}
 
-    // Update total size
-    map->buckets.size++;
+void *hashmap_get_or_insert(hashmap_t *map, size_t key, void *val) {
+    int inserted;
+    void **slot = hashmap_entry(map, key, &inserted);
+    if (!slot) return NULL;
 
-    return __TRUE;
+    if (inserted) {
+        (*slot) = val;
+    }
+    return *slot;
+}
+
+void *hashmap_upsert(hashmap_t *map, size_t key, void *val) {
+    void **slot = hashmap_entry(map, key, NULL);
+    if (!slot) return NULL;
+
+    void *old = *slot;
+    (*slot) = val;
+    return old;
 }
 
 void *hashmap_remove(hashmap_t *map, size_t key) {
-    if (!map || !map->buckets.buf) return NULL;
-
-    // Determine bucket to locate key/value pair
-    size_t index = __calc_index(map->seed, key, map->buckets.len);
-    bucket_t *bucket = map->buckets.buf + index;
-
-    // Linearly search for matching key, if it exists
-    if (bucket->cap == 0) return NULL;
-    for (size_t i = 0; i < bucket->len; i++) {
-        kv_t *pair = bucket->pairs + i;
-        if (pair->key == key) {
-            // Remove from bucket - bucket should
-            // not be null, and `i` should be in-range
-            return bucket_remove(bucket, i);
+    if (!map) return NULL;
+
+    size_t i;
+    container_t *container = __hashmap_find(map, __hash(map, key), key, &i);
+    if (container == NULL) {
+        __hashmap_migrate_step(map);
+        return NULL;
+    }
+
+    size_t position = container->slots[i];
+    kv_t *pair = __hashmap_entry(map, position);
+    void *val = pair->val;
+    __container_remove(container, i);
+
+    // Keep the entries packed by moving the last one into the
+    // hole, and point whichever slot held it at its new place
+    size_t last = --map->num_entries;
+    if (position != last) {
+        (*pair) = *__hashmap_entry(map, last);
+        uint64_t hash = __hash(map, pair->key);
+
+        container = &map->buckets;
+        i = __container_find_position(container, hash, last);
+        if (i == container->len) {
+            container = &map->old_buckets;
+            i = __container_find_position(container, hash, last);
         }
+        container->slots[i] = position;
+    }
+    if (map->old_entries_len > map->num_entries) {
+        map->old_entries_len = map->num_entries;
     }
 
-    return NULL;
+    __hashmap_migrate_step(map);
+    __hashmap_maybe_shrink(map);
+    return val;
+}
+
+/// Makes room for `capacity` pairs in total, all at once.
+static void __hashmap_reserve(hashmap_t *map, size_t capacity) {
+    // A reservation is meant to avoid rehashing later,
+    // so finish any incremental rehash right away
+    if (__hashmap_migrating(map)) {
+        __hashmap_migrate(map, SIZE_MAX);
+    }
+
+    // Deleted slots can't be reused by new keys until they
+    // happen to be probed, so only truly empty ones count
+    if (capacity > map->buckets.size + map->buckets.growth_left) {
+        int flags = map->flags;
+        map->flags &= ~HASHMAP_INCREMENTAL_REHASH;
+        __hashmap_rehash(map, capacity);
+        map->flags = flags;
+    }
+}
+
+void hashmap_reserve(hashmap_t *map, size_t capacity) {
+    if (!map) return;
+
+    map->reserved = capacity;
+    __hashmap_reserve(map, capacity);
+}
+
+int hashmap_insert_bulk(hashmap_t *map, const size_t *keys, void *const *vals, size_t n) {
+    if (!map) return __FALSE;
+    if (n == 0) return __TRUE;
+
+    __hashmap_reserve(map, map->num_entries + n);
+
+    container_t *buckets = &map->buckets;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t hash = __hash(map, keys[i]);
+        size_t index = __container_find_insert_slot(buckets, hash);
+        size_t position = map->num_entries++;
+        map->entries[position] = (kv_t) {.key = keys[i], .val = vals[i]};
+        __container_set(buckets, index, hash, position);
+    }
+
+    return __TRUE;
+}
+
+void hashmap_shrink_to_fit(hashmap_t *map) {
+    if (!map) return;
+
+    map->reserved = 0;
+    if (__hashmap_migrating(map)) {
+        __hashmap_migrate(map, SIZE_MAX);
+    }
+
+    if (map->num_entries == 0) {
+        if (map->entries != NULL) {
+            map->alloc.free(map->alloc.ctx, map->entries);
+        }
+        map->entries = NULL;
+        map->entries_cap = 0;
+        __container_delete(&map->alloc, &map->buckets);
+        return;
+    }
+
+    size_t new_len = GROUP_WIDTH;
+    while (__group_capacity(new_len) < map->num_entries) {
+        new_len *= 2;
+    }
+    if (new_len < map->buckets.len || map->entries_cap > __group_capacity(new_len)) {
+        int flags = map->flags;
+        map->flags &= ~HASHMAP_INCREMENTAL_REHASH;
+        __hashmap_rehash(map, map->num_entries);
+        map->flags = flags;
+    }
+}
+
+size_t hashmap_memory_usage(hashmap_t *map) {
+    if (!map) return 0;
+
+    size_t container_slot_u8 = sizeof(size_t) + sizeof(int8_t);
+    return sizeof(hashmap_t)
+         + sizeof(kv_t) * (map->entries_cap + map->old_entries_cap)
+         + container_slot_u8 * (map->buckets.len + map->old_buckets.len);
 }
 
 int hashmap_is_empty(hashmap_t *map) {
-    return (map) ? map->buckets.size == 0 : __TRUE;
+    return (map) ? map->num_entries == 0 : __TRUE;
+}
+
+size_t hashmap_len(hashmap_t *map) {
+    return (map) ? map->num_entries : 0;
+}
+
+void hashmap_for_each(hashmap_t *map, void (*fn)(size_t key, void *val, void *ctx), void *ctx) {
+    if (!map) return;
+
+    for (size_t i = 0; i < map->num_entries; i++) {
+        kv_t *pair = __hashmap_entry(map, i);
+        fn(pair->key, pair->val, ctx);
+    }
+}
+
+hashmap_iter_t hashmap_iter(hashmap_t *map) {
+    return (hashmap_iter_t) {
+        .map = map,
+        .next = 0
+    };
+}
+
+int hashmap_iter_next(hashmap_iter_t *iter, size_t *key, void **val) {
+    hashmap_t *map = iter->map;
+    if (!map || iter->next >= map->num_entries) return __FALSE;
+
+    kv_t *pair = __hashmap_entry(map, iter->next++);
+    if (key != NULL) *key = pair->key;
+    if (val != NULL) *val = pair->val;
+    return __TRUE;
 }
@@ -0,0 +1,338 @@
+#define _GNU_SOURCE
+
+#include "intern.h"
+#include "group.h"
+#include "hash.h"
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Number of strings in the first chunk of the ID table. Every
+/// further chunk is twice as big as the one before it.
+#define CHUNK_BASE_BITS 10
+#define CHUNK_BASE ((size_t)1 << CHUNK_BASE_BITS)
+
+/// Enough chunks to hand out every 32-bit ID.
+#define MAX_CHUNKS (32 - CHUNK_BASE_BITS + 1)
+
+/// String chunks start out this big and double up to
+/// STRING_CHUNK_MAX, unless a single string needs more.
+#define STRING_CHUNK_MIN 4096
+#define STRING_CHUNK_MAX (1024 * 1024)
+
+/// A block of interned strings, packed back to back. The newest
+/// chunk is first, and only that one still has room left.
+typedef struct strchunk_t {
+    struct strchunk_t *next;
+    size_t used;
+    size_t cap;
+    char bytes[];
+} strchunk_t;
+
+/// An interned string along with its full hash, so that
+/// growing the index never has to rehash the strings.
+typedef struct {
+    uint32_t hash;
+    size_t len;
+    const char *buf;
+} ientry_t;
+
+struct intern_t {
+    uint32_t seed;
+    int flags;
+
+    /// The number of IDs handed out. Stored with release
+    /// semantics once the string with the last ID is in place.
+    uint32_t count;
+
+    /// Maps strings to IDs, with the same control groups as
+    /// `strmap_t`. Each slot only holds an ID, since the
+    /// string and its hash live in the ID table.
+    size_t len;
+    size_t growth_left;
+    int8_t *ctrl;
+    uint32_t *ids;
+
+    /// Maps IDs to strings. Chunks never move once they're
+    /// allocated, so lookups don't need to lock anything.
+    ientry_t *chunks[MAX_CHUNKS];
+
+    /// Holds the strings themselves. Chunks are only
+    /// freed along with the interner, so strings never move.
+    strchunk_t *strings;
+
+    /// Only used with INTERN_THREAD_SAFE. Guards everything
+    /// above, except for entries that were already published.
+    pthread_rwlock_t lock;
+};
+
+
+// -------------------------------------------------
+// INTERN HELPER FUNCTIONS
+// -------------------------------------------------
+
+/// Returns the chunk of the ID table that holds `id`.
+/// Chunk k holds the IDs from CHUNK_BASE * (2^k - 1) on.
+static inline size_t __chunk_of(uint32_t id) {
+    size_t x = ((size_t)id >> CHUNK_BASE_BITS) + 1;
+    return (sizeof(size_t) * 8 - 1) - __builtin_clzl(x);
+}
+
+static inline uint32_t __hash(const intern_t *intern, borrowed_string_t str) {
+    uint64_t hash = hash_bytes(str.buf, str.len, intern->seed);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static inline ientry_t *__intern_entry(const intern_t *intern, uint32_t id) {
+    size_t chunk = __chunk_of(id);
+    size_t first = CHUNK_BASE * (((size_t)1 << chunk) - 1);
+    return intern->chunks[chunk] + ((size_t)id - first);
+}
+
+/// Copies `len` bytes and a NUL terminator into the string
+/// chunks, starting a new chunk if the newest one is full,
+/// and returns where they were copied.
+static const char *__strings_copy(strchunk_t **strings, const char *buf, size_t len) {
+    strchunk_t *chunk = *strings;
+    if (chunk == NULL || len + 1 > chunk->cap - chunk->used) {
+        size_t cap = (chunk == NULL) ? STRING_CHUNK_MIN : chunk->cap * 2;
+        if (cap > STRING_CHUNK_MAX) {
+            cap = STRING_CHUNK_MAX;
+        }
+        if (cap < len + 1) {
+            cap = len + 1;
+        }
+
+        chunk = malloc(sizeof(strchunk_t) + cap);
+        if (!chunk) {
+            __logln_err_fmt("Couldn't copy string into the interner: %s", strerror(errno));
+            exit(1);
+        }
+        chunk->next = *strings;
+        chunk->used = 0;
+        chunk->cap = cap;
+        (*strings) = chunk;
+    }
+
+    char *copy = chunk->bytes + chunk->used;
+    (void)memcpy(copy, buf, len);
+    copy[len] = '\0';
+    chunk->used += len + 1;
+    return copy;
+}
+
+/// Returns the ID of the string, or INTERN_NONE
+/// if it isn't in the index.
+static uint32_t __intern_find(const intern_t *intern, uint32_t hash, const char *buf, size_t len) {
+    if (intern->len == 0) return INTERN_NONE;
+
+    size_t group_mask = intern->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    int8_t tag = (int8_t)(hash & 0x7f);
+
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        const int8_t *ctrl = intern->ctrl + base;
+
+        bitmask_t candidates = __group_match(ctrl, tag);
+        while (candidates != 0) {
+            uint32_t id = intern->ids[base + __bitmask_next(&candidates)];
+            const ientry_t *entry = __intern_entry(intern, id);
+            if (entry->hash == hash && entry->len == len && memcmp(entry->buf, buf, len) == 0) {
+                return id;
+            }
+        }
+
+        if (__group_match_empty(ctrl) != 0) {
+            return INTERN_NONE;
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+/// Returns the index of the first empty slot along `hash`'s
+/// probe sequence. Strings are never removed from the index,
+/// so it has no deleted slots.
+static size_t __intern_find_insert_slot(const intern_t *intern, uint32_t hash) {
+    size_t group_mask = intern->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        bitmask_t free_slots = __group_match_empty(intern->ctrl + base);
+        if (free_slots != 0) {
+            return base + __bitmask_next(&free_slots);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+static inline void __intern_set(intern_t *intern, size_t i, uint32_t hash, uint32_t id) {
+    intern->ctrl[i] = (int8_t)(hash & 0x7f);
+    intern->ids[i] = id;
+    intern->growth_left--;
+}
+
+/// Moves every ID into an index twice the size.
+static void __intern_grow(intern_t *intern) {
+    size_t new_len = (intern->len == 0) ? GROUP_WIDTH : intern->len * 2;
+
+    void *new_ptr = malloc((sizeof(uint32_t) + sizeof(int8_t)) * new_len);
+    if (!new_ptr) {
+        __logln_err_fmt("Interner couldn't be reallocated: %s", strerror(errno));
+        exit(1);
+    }
+
+    uint32_t *old_ids = intern->ids;
+    int8_t *old_ctrl = intern->ctrl;
+    size_t old_len = intern->len;
+
+    intern->ids = new_ptr;
+    intern->ctrl = (int8_t *)(intern->ids + new_len);
+    intern->len = new_len;
+    intern->growth_left = __group_capacity(new_len);
+    (void)memset(intern->ctrl, CTRL_EMPTY, new_len);
+
+    for (size_t i = 0; i < old_len; i++) {
+        if (old_ctrl[i] < 0) continue;
+        uint32_t hash = __intern_entry(intern, old_ids[i])->hash;
+        __intern_set(intern, __intern_find_insert_slot(intern, hash), hash, old_ids[i]);
+    }
+
+    free(old_ids);
+}
+
+/// Copies the string into the interner and gives it the next ID.
+static uint32_t __intern_insert(intern_t *intern, uint32_t hash, const char *buf, size_t len) {
+    uint32_t id = intern->count;
+    if (id == INTERN_NONE) {
+        __logln_err("Interner ran out of IDs");
+        exit(1);
+    }
+
+    size_t chunk = __chunk_of(id);
+    if (intern->chunks[chunk] == NULL) {
+        intern->chunks[chunk] = malloc((CHUNK_BASE << chunk) * sizeof(ientry_t));
+        if (intern->chunks[chunk] == NULL) {
+            __logln_err_fmt("Couldn't grow the interner's ID table: %s", strerror(errno));
+            exit(1);
+        }
+    }
+
+    (*__intern_entry(intern, id)) = (ientry_t) {
+        .hash = hash,
+        .len = len,
+        .buf = __strings_copy(&intern->strings, buf, len)
+    };
+
+    if (intern->growth_left == 0) {
+        __intern_grow(intern); // EXPENSIVE
+    }
+    __intern_set(intern, __intern_find_insert_slot(intern, hash), hash, id);
+
+    __atomic_store_n(&intern->count, id + 1, __ATOMIC_RELEASE);
+    return id;
+}
+
+
+// -------------------------------------------------
+// INTERN DEFINITIONS
+// -------------------------------------------------
+
+intern_t *intern_new(const int flags) {
+    intern_t *intern = malloc(sizeof(intern_t));
+    if (!intern) {
+        return NULL;
+    }
+
+    (void)memset(intern, 0, sizeof(intern_t));
+    intern->seed = time(0);
+    intern->flags = flags;
+
+    if (flags & INTERN_THREAD_SAFE) {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&intern->lock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+
+    return intern;
+}
+
+void intern_delete(intern_t *intern) {
+    if (!intern) return;
+
+    if (intern->flags & INTERN_THREAD_SAFE) {
+        pthread_rwlock_destroy(&intern->lock);
+    }
+    free(intern->ids);
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+        free(intern->chunks[i]);
+    }
+    while (intern->strings != NULL) {
+        strchunk_t *next = intern->strings->next;
+        free(intern->strings);
+        intern->strings = next;
+    }
+    free(intern);
+}
+
+uint32_t intern(intern_t *intern, borrowed_string_t str) {
+    uint32_t hash = __hash(intern, str);
+
+    if (!(intern->flags & INTERN_THREAD_SAFE)) {
+        uint32_t id = __intern_find(intern, hash, str.buf, str.len);
+        return (id != INTERN_NONE) ? id : __intern_insert(intern, hash, str.buf, str.len);
+    }
+
+    // Most strings were interned before, which only needs the
+    // shared lock. Otherwise look again under the exclusive
+    // lock, since another thread may have beaten us to it.
+    pthread_rwlock_rdlock(&intern->lock);
+    uint32_t id = __intern_find(intern, hash, str.buf, str.len);
+    pthread_rwlock_unlock(&intern->lock);
+    if (id != INTERN_NONE) return id;
+
+    pthread_rwlock_wrlock(&intern->lock);
+    id = __intern_find(intern, hash, str.buf, str.len);
+    if (id == INTERN_NONE) {
+        id = __intern_insert(intern, hash, str.buf, str.len);
+    }
+    pthread_rwlock_unlock(&intern->lock);
+    return id;
+}
+
+uint32_t intern_find(intern_t *intern, borrowed_string_t str) {
+    uint32_t hash = __hash(intern, str);
+
+    if (!(intern->flags & INTERN_THREAD_SAFE)) {
+        return __intern_find(intern, hash, str.buf, str.len);
+    }
+
+    pthread_rwlock_rdlock(&intern->lock);
+    uint32_t id = __intern_find(intern, hash, str.buf, str.len);
+    pthread_rwlock_unlock(&intern->lock);
+    return id;
+}
+
+borrowed_string_t intern_lookup(intern_t *intern, uint32_t id) {
+    if (id >= __atomic_load_n(&intern->count, __ATOMIC_ACQUIRE)) {
+        return (borrowed_string_t) {.len = 0, .buf = NULL};
+    }
+
+    const ientry_t *entry = __intern_entry(intern, id);
+    return (borrowed_string_t) {
+        .len = entry->len,
+        .buf = (char *)entry->buf
+    };
+}
+
+size_t intern_len(intern_t *intern) {
+    return __atomic_load_n(&intern->count, __ATOMIC_ACQUIRE);
+}
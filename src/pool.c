@@ -0,0 +1,394 @@
+#include "pool.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// How much memory a pool allocates
+/// from the heap whenever it runs dry.
+#ifndef POOL_CHUNK_SIZE
+#define POOL_CHUNK_SIZE (64 * 1024) // 64 Kilobytes
+#endif
+
+/// The most free slots that a thread's cache holds
+/// before it hands half of them back to the pool.
+#ifndef POOL_CACHE_SLOTS
+#define POOL_CACHE_SLOTS 64
+#endif
+
+#define SLOT_ALIGNMENT (2 * sizeof(void *))
+
+/// A chunk of slots, which starts with a link to the chunk
+/// allocated before it. The header takes up a whole slot
+/// alignment, so that the slots after it stay aligned.
+typedef struct chunk_t {
+    struct chunk_t *next;
+} chunk_t;
+
+#define CHUNK_HEADER_SIZE SLOT_ALIGNMENT
+
+/// A free slot. The link to the next free
+/// slot lives inside the slot's own memory.
+typedef struct slot_t {
+    struct slot_t *next;
+} slot_t;
+
+/// A thread's private stack of free slots for a POOL_THREAD_CACHE
+/// pool. Every thread keeps a list of its caches, one per pool it
+/// used, and every pool keeps a list of the caches made for it.
+typedef struct cache_t {
+    /// Set to NULL when the pool is deleted, after which
+    /// the cache is only waiting for its thread to free it.
+    _Atomic(pool_t *) pool;
+    slot_t *free;
+    size_t len;
+
+    /// The next cache of the same thread.
+    struct cache_t *next;
+
+    /// The next cache of the same pool, guarded by `caches_lock`.
+    struct cache_t *next_in_pool;
+} cache_t;
+
+/// Guards every pool's list of caches, as well as pools being
+/// deleted while threads that cached their slots exit. Taken
+/// before a pool's own mutex, and only when a thread starts
+/// or stops using a pool.
+static pthread_mutex_t caches_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// The calling thread's caches, most recently used first.
+static _Thread_local cache_t *local_caches = NULL;
+
+/// One key for all pools, which hands a thread's cached
+/// slots back to their pools when the thread exits.
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static int cache_key_ok = 0;
+
+struct pool_t {
+    size_t slot_size;
+    int flags;
+
+    /// Every chunk of slots, newest first.
+    chunk_t *chunks;
+
+    /// Slots that were freed back to the pool.
+    slot_t *free;
+
+    /// The part of the last chunk that hasn't been handed out.
+    uint8_t *bump;
+    uint8_t *bump_end;
+
+    /// Only used with POOL_THREAD_CACHE. The mutex guards
+    /// every field above, and `caches_lock` guards `caches`.
+    pthread_mutex_t mutex;
+    cache_t *caches;
+};
+
+
+// -------------------------------------------------
+// POOL HELPER FUNCTIONS
+// -------------------------------------------------
+
+/// Pops a slot off the pool's free list, or carves a new one
+/// out of its last chunk. Returns NULL if out of memory.
+static slot_t *__pool_take(pool_t *pool) {
+    slot_t *slot = pool->free;
+    if (slot != NULL) {
+        pool->free = slot->next;
+        return slot;
+    }
+
+    if (pool->bump == pool->bump_end) {
+        size_t num_slots = POOL_CHUNK_SIZE / pool->slot_size;
+        if (num_slots == 0) {
+            num_slots = 1;
+        }
+
+        chunk_t *chunk = malloc(CHUNK_HEADER_SIZE + num_slots * pool->slot_size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->bump = (uint8_t *)chunk + CHUNK_HEADER_SIZE;
+        pool->bump_end = pool->bump + num_slots * pool->slot_size;
+    }
+
+    slot = (slot_t *)pool->bump;
+    pool->bump += pool->slot_size;
+    return slot;
+}
+
+/// Pushes a slot onto the pool's free list.
+static inline void __pool_give(pool_t *pool, slot_t *slot) {
+    slot->next = pool->free;
+    pool->free = slot;
+}
+
+/// Thread exit handler; returns every cached slot to its pool
+/// and frees the thread's caches. The key's value is unused.
+static void __caches_release(void *_unused) {
+    (void)_unused;
+
+    pthread_mutex_lock(&caches_lock);
+    while (local_caches != NULL) {
+        cache_t *cache = local_caches;
+        local_caches = cache->next;
+
+        pool_t *pool = atomic_load_explicit(&cache->pool, memory_order_relaxed);
+        if (pool != NULL) {
+            pthread_mutex_lock(&pool->mutex);
+            while (cache->free != NULL) {
+                slot_t *slot = cache->free;
+                cache->free = slot->next;
+                __pool_give(pool, slot);
+            }
+            pthread_mutex_unlock(&pool->mutex);
+
+            cache_t **link = &pool->caches;
+            while (*link != cache) {
+                link = &(*link)->next_in_pool;
+            }
+            (*link) = cache->next_in_pool;
+        }
+        free(cache);
+    }
+    pthread_mutex_unlock(&caches_lock);
+}
+
+static void __cache_key_create(void) {
+    cache_key_ok = pthread_key_create(&cache_key, __caches_release) == 0;
+}
+
+/// Frees the calling thread's caches of pools that were deleted.
+static void __caches_prune(void) {
+    cache_t **link = &local_caches;
+    while (*link != NULL) {
+        cache_t *cache = *link;
+        if (atomic_load_explicit(&cache->pool, memory_order_acquire) == NULL) {
+            (*link) = cache->next;
+            free(cache);
+        } else {
+            link = &cache->next;
+        }
+    }
+}
+
+/// Slow path of `__cache_get`: finds the thread's cache for the
+/// pool further down its list, or creates it. Returns NULL if the
+/// cache couldn't be allocated.
+static cache_t *__cache_find(pool_t *pool) {
+    __caches_prune();
+
+    cache_t **link = &local_caches;
+    while (*link != NULL && atomic_load_explicit(&(*link)->pool, memory_order_relaxed) != pool) {
+        link = &(*link)->next;
+    }
+
+    cache_t *cache = *link;
+    if (cache != NULL) {
+        (*link) = cache->next;
+    } else {
+        (void)pthread_once(&cache_key_once, __cache_key_create);
+        if (!cache_key_ok) {
+            return NULL;
+        }
+
+        cache = malloc(sizeof(cache_t));
+        if (cache == NULL) {
+            return NULL;
+        }
+        atomic_init(&cache->pool, pool);
+        cache->free = NULL;
+        cache->len = 0;
+
+        pthread_mutex_lock(&caches_lock);
+        cache->next_in_pool = pool->caches;
+        pool->caches = cache;
+        pthread_mutex_unlock(&caches_lock);
+
+        // Any value but NULL makes the thread run
+        // `__caches_release` when it exits
+        if (pthread_setspecific(cache_key, cache) != 0) {
+            __logln_warn("Couldn't register the pool's thread cache");
+        }
+    }
+
+    // Keep the most recently used cache in front
+    cache->next = local_caches;
+    local_caches = cache;
+    return cache;
+}
+
+/// Returns the calling thread's cache for the pool, creating it on
+/// first use. Returns NULL if the cache couldn't be allocated.
+static inline cache_t *__cache_get(pool_t *pool) {
+    cache_t *cache = local_caches;
+    if (cache != NULL && atomic_load_explicit(&cache->pool, memory_order_relaxed) == pool) {
+        return cache;
+    }
+    return __cache_find(pool);
+}
+
+static void *__allocator_alloc(void *ctx, const size_t n) {
+    pool_t *pool = ctx;
+    if (n > pool->slot_size) {
+        return NULL;
+    }
+    return pool_alloc(pool);
+}
+
+/// Slots never move, so a block can only "grow"
+/// within the slot it already has.
+static void *__allocator_realloc(void *ctx, void *ptr, const size_t _old_n, const size_t new_n) {
+    pool_t *pool = ctx;
+    (void)_old_n;
+    return (new_n <= pool->slot_size) ? ptr : NULL;
+}
+
+static void __allocator_free(void *ctx, void *ptr) {
+    pool_free(ctx, ptr);
+}
+
+
+// -------------------------------------------------
+// POOL DEFINITIONS
+// -------------------------------------------------
+
+pool_t *pool_new(const size_t obj_size, const int flags) {
+    pool_t *pool = malloc(sizeof(pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    size_t slot_size = (obj_size > sizeof(slot_t)) ? obj_size : sizeof(slot_t);
+    slot_size = (slot_size + SLOT_ALIGNMENT - 1) & ~(SLOT_ALIGNMENT - 1);
+
+    (*pool) = (pool_t) {
+        .slot_size = slot_size,
+        .flags = flags,
+        .chunks = NULL,
+        .free = NULL,
+        .bump = NULL,
+        .bump_end = NULL,
+        .caches = NULL
+    };
+
+    if (flags & POOL_THREAD_CACHE) {
+        pthread_mutex_init(&pool->mutex, NULL);
+    }
+
+    return pool;
+}
+
+void *pool_alloc(pool_t *pool) {
+    if (!(pool->flags & POOL_THREAD_CACHE)) {
+        return __pool_take(pool);
+    }
+
+    cache_t *cache = __cache_get(pool);
+    if (cache == NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        slot_t *slot = __pool_take(pool);
+        pthread_mutex_unlock(&pool->mutex);
+        return slot;
+    }
+
+    if (cache->free == NULL) {
+        // Refill half the cache in one go so the
+        // next few allocations don't need the lock
+        pthread_mutex_lock(&pool->mutex);
+        for (size_t i = 0; i < POOL_CACHE_SLOTS / 2; i++) {
+            slot_t *slot = __pool_take(pool);
+            if (slot == NULL) break;
+            slot->next = cache->free;
+            cache->free = slot;
+            cache->len++;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (cache->free == NULL) {
+            return NULL;
+        }
+    }
+
+    slot_t *slot = cache->free;
+    cache->free = slot->next;
+    cache->len--;
+    return slot;
+}
+
+void pool_free(pool_t *pool, void *ptr) {
+    if (ptr == NULL) return;
+    slot_t *slot = ptr;
+
+    if (!(pool->flags & POOL_THREAD_CACHE)) {
+        __pool_give(pool, slot);
+        return;
+    }
+
+    cache_t *cache = __cache_get(pool);
+    if (cache == NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        __pool_give(pool, slot);
+        pthread_mutex_unlock(&pool->mutex);
+        return;
+    }
+
+    slot->next = cache->free;
+    cache->free = slot;
+    cache->len++;
+
+    if (cache->len > POOL_CACHE_SLOTS) {
+        // Give half back, so that slots freed by one thread
+        // can be reused by the threads that allocate them
+        pthread_mutex_lock(&pool->mutex);
+        while (cache->len > POOL_CACHE_SLOTS / 2) {
+            slot = cache->free;
+            cache->free = slot->next;
+            cache->len--;
+            __pool_give(pool, slot);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+void pool_delete(pool_t *pool) {
+    if (pool == NULL) return;
+
+    if (pool->flags & POOL_THREAD_CACHE) {
+        // Threads free their caches of the pool later on, either
+        // when they next look for a cache or when they exit
+        pthread_mutex_lock(&caches_lock);
+        cache_t *cache = pool->caches;
+        while (cache != NULL) {
+            cache_t *next = cache->next_in_pool;
+            atomic_store_explicit(&cache->pool, NULL, memory_order_release);
+            cache = next;
+        }
+        pthread_mutex_unlock(&caches_lock);
+
+        __caches_prune();
+        pthread_mutex_destroy(&pool->mutex);
+    }
+
+    while (pool->chunks != NULL) {
+        chunk_t *chunk = pool->chunks;
+        pool->chunks = chunk->next;
+        free(chunk);
+    }
+    free(pool);
+}
+
+allocator pool_allocator(pool_t *pool) {
+    return (allocator) {
+        .ctx = pool,
+        .alloc = __allocator_alloc,
+        .realloc = __allocator_realloc,
+        .free = __allocator_free
+    };
+}
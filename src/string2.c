@@ -1,44 +1,638 @@
 #include "string2.h"
-#include "error.h"
 
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define DEFAULT_CAPACITY 16
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+/// Formats up to this long are built on the stack
+/// by `string_vappendf` before being appended.
+#ifndef APPENDF_BUFFER_SIZE
+#define APPENDF_BUFFER_SIZE 256
+#endif
+
+/// Leaves `str` as an empty inline string.
+static void __string_init_inline(owned_string_t *str) {
+    str->len = 0;
+    str->cap = STRING_INLINE_CAP;
+    str->data.small[0] = '\0';
+}
+
+/// Resizes the string's buffer to hold `capacity` bytes plus
+/// the terminator, moving an inline string out to the heap.
+/// Returns 1 on success, and 0 if the buffer couldn't be
+/// resized, in which case it is left untouched.
+static int __string_resize(owned_string_t *str, size_t capacity) {
+    // Anything that isn't inline needs a bigger capacity than
+    // inline strings have, which is how the two are told apart
+    if (capacity <= STRING_INLINE_CAP) {
+        capacity = STRING_INLINE_CAP + 1;
+    }
+
+    char *buf;
+    arena_t *arena = NULL;
+    if (string_is_inline(str)) {
+        buf = malloc(capacity + 1);
+        if (buf != NULL) {
+            (void)memcpy(buf, str->data.small, str->len + 1);
+        }
+    } else if (str->data.heap.arena != NULL) {
+        // The arena's allocator grows the buffer in place
+        // if it's the last allocation, and copies it if not
+        arena = str->data.heap.arena;
+        allocator alloc = arena_allocator(arena);
+        buf = alloc.realloc(alloc.ctx, str->data.heap.buf, str->cap + 1, capacity + 1);
+    } else {
+        buf = realloc(str->data.heap.buf, capacity + 1);
+    }
+    if (buf == NULL) {
+        return 0;
+    }
+
+    str->data.heap.buf = buf;
+    str->data.heap.arena = arena;
+    str->cap = capacity;
+    return 1;
+}
 
 int string_alloc(owned_string_t *str) {
-    return string_alloc_with_cap(str, DEFAULT_CAPACITY);
+    __string_init_inline(str);
+    return 1;
 }
 
 int string_alloc_with_cap(owned_string_t *str, size_t capacity) {
-    char *buf = malloc(sizeof(char) * capacity);
-    if (!buf) {
-        return 0;
+    __string_init_inline(str);
+    return (capacity <= STRING_INLINE_CAP) ? 1 : __string_resize(str, capacity);
+}
+
+int string_alloc_in(owned_string_t *str, arena_t *arena, size_t capacity) {
+    __string_init_inline(str);
+    if (capacity <= STRING_INLINE_CAP) {
+        capacity = STRING_INLINE_CAP + 1;
     }
 
-    (void) memset(buf, 0, capacity);
-    (*str) = (owned_string_t) {
-        .buf = buf,
-        .cap = capacity,
-        .len = capacity
-    };
+    char *buf = arena_alloc_nozero_in(arena, capacity + 1);
+    if (buf == NULL) {
+        return 0;
+    }
 
+    buf[0] = '\0';
+    str->data.heap.buf = buf;
+    str->data.heap.arena = arena;
+    str->cap = capacity;
     return 1;
 }
 
 void string_delete(owned_string_t *str) {
-    if (str->buf) {
-        free(str->buf);
+    if (!string_is_inline(str) && str->data.heap.arena == NULL) {
+        free(str->data.heap.buf);
+    }
+
+    __string_init_inline(str);
+}
+
+int string_reserve(owned_string_t *str, size_t additional) {
+    if (additional > SIZE_MAX - 1 - str->len) {
+        return 0;
+    }
+    size_t needed = str->len + additional;
+    if (needed <= str->cap) {
+        return 1;
+    }
+
+    // A zeroed string is empty and inline, but has a capacity
+    // of 0, so double from what an inline string can hold
+    size_t capacity = (str->cap > STRING_INLINE_CAP) ? str->cap : STRING_INLINE_CAP;
+    while (capacity < needed && capacity <= (SIZE_MAX - 1) / 2) {
+        capacity *= 2;
+    }
+    if (capacity < needed) {
+        capacity = needed;
+    }
+
+    return __string_resize(str, capacity);
+}
+
+int string_append(owned_string_t *str, const void *bytes, size_t n) {
+    if (n > str->cap - str->len && !string_reserve(str, n)) {
+        return 0;
     }
 
-    str->buf = NULL;
-    str->cap = 0;
+    char *buf = string_buf(str);
+    (void)memcpy(buf + str->len, bytes, n);
+    str->len += n;
+    buf[str->len] = '\0';
+    return 1;
+}
+
+int string_append_str(owned_string_t *str, borrowed_string_t other) {
+    return string_append(str, other.buf, other.len);
+}
+
+int string_appendf(owned_string_t *str, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = string_vappendf(str, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int string_vappendf(owned_string_t *str, const char *fmt, va_list args) {
+    // Format into the spare capacity, or a stack buffer if that's
+    // bigger, so that short formats are only formatted once even
+    // when the string has to grow for them
+    char local[APPENDF_BUFFER_SIZE];
+    size_t spare = str->cap - str->len + 1;
+    int in_place = spare >= sizeof(local);
+
+    va_list retry;
+    va_copy(retry, args);
+    int n = vsnprintf(in_place ? string_buf(str) + str->len : local,
+                      in_place ? spare : sizeof(local), fmt, args);
+
+    int ok = (n >= 0);
+    if (ok && !in_place && (size_t)n < sizeof(local)) {
+        ok = string_append(str, local, (size_t)n);
+        n = 0;
+    } else if (ok && (size_t)n >= spare) {
+        ok = string_reserve(str, (size_t)n);
+        if (ok) {
+            (void)vsnprintf(string_buf(str) + str->len, (size_t)n + 1, fmt, retry);
+        }
+    }
+    va_end(retry);
+
+    if (!ok) {
+        // Drop whatever got written past the end of the string
+        string_buf(str)[str->len] = '\0';
+        return 0;
+    }
+
+    str->len += (size_t)n;
+    return 1;
+}
+
+void string_clear(owned_string_t *str) {
     str->len = 0;
+    string_buf(str)[0] = '\0';
 }
 
 borrowed_string_t string_view(owned_string_t *str) {
     return (borrowed_string_t) {
-        .buf = str->buf,
+        .buf = string_buf(str),
         .len = str->len,
     };
-}
\ No newline at end of file
+}
+
+
+// -------------------------------------------------
+// BORROWED STRING KERNELS
+// -------------------------------------------------
+
+static inline uint64_t __load64(const char *p) {
+    uint64_t k;
+    (void)memcpy(&k, p, sizeof(uint64_t));
+    return k;
+}
+
+static inline uint32_t __load32(const char *p) {
+    uint32_t k;
+    (void)memcpy(&k, p, sizeof(uint32_t));
+    return k;
+}
+
+/// Lowercases an ASCII letter, and leaves other bytes alone.
+static inline int __fold(char c) {
+    unsigned char u = (unsigned char)c;
+    return ((unsigned)(u - 'A') < 26) ? u + ('a' - 'A') : u;
+}
+
+/// Compares fewer than 16 bytes with at most two loads
+/// per string, which overlap for odd lengths.
+static inline int __eq_small(const char *a, const char *b, size_t len) {
+    if (len >= 8) {
+        return (__load64(a) == __load64(b)) & (__load64(a + len - 8) == __load64(b + len - 8));
+    }
+    if (len >= 4) {
+        return (__load32(a) == __load32(b)) & (__load32(a + len - 4) == __load32(b + len - 4));
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static int __eq_scalar(const char *a, const char *b, size_t len) {
+    return len == 0 || memcmp(a, b, len) == 0;
+}
+
+static size_t __find_byte_scalar(const char *str, size_t len, char c) {
+    const char *found = (len != 0) ? memchr(str, c, len) : NULL;
+    return (found != NULL) ? (size_t)(found - str) : STRING_NOT_FOUND;
+}
+
+/// Finds a needle of `m` bytes, where 2 <= m <= n.
+static size_t __find_scalar(const char *str, size_t n, const char *needle, size_t m) {
+    for (size_t i = 0; i + m <= n; i++) {
+        const char *first = memchr(str + i, needle[0], n - m + 1 - i);
+        if (first == NULL) break;
+
+        i = (size_t)(first - str);
+        if (memcmp(str + i + 1, needle + 1, m - 1) == 0) {
+            return i;
+        }
+    }
+    return STRING_NOT_FOUND;
+}
+
+/// Returns the difference between the first pair of bytes
+/// that differ when folded, or 0 if there is none.
+static int __casecmp_scalar(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        int diff = __fold(a[i]) - __fold(b[i]);
+        if (diff != 0) return diff;
+    }
+    return 0;
+}
+
+#ifdef __SSE2__
+
+/// Lowercases the ASCII letters of a block. Adding 0x80 - 'A'
+/// moves 'A'..'Z' to the 26 smallest signed bytes, so a single
+/// signed compare tells letters apart from everything else.
+static inline __m128i __fold_sse2(__m128i x) {
+    __m128i shifted = _mm_add_epi8(x, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline uint32_t __eq_mask_sse2(const char *a, const char *b) {
+    __m128i x = _mm_loadu_si128((const __m128i *)a);
+    __m128i y = _mm_loadu_si128((const __m128i *)b);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+}
+
+static int __eq_sse2(const char *a, const char *b, size_t len) {
+    if (len < 16) return __eq_small(a, b, len);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        if (__eq_mask_sse2(a + i, b + i) != 0xffff) return 0;
+    }
+    // The last block overlaps bytes that were already compared
+    return i == len || __eq_mask_sse2(a + len - 16, b + len - 16) == 0xffff;
+}
+
+static size_t __find_byte_sse2(const char *str, size_t len, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(str + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    if (i == len) return STRING_NOT_FOUND;
+
+    if (len < 16) {
+        for (; i < len; i++) {
+            if (str[i] == c) return i;
+        }
+        return STRING_NOT_FOUND;
+    }
+
+    // Search the last block, skipping the bytes it
+    // shares with the blocks that were searched
+    size_t last = len - 16;
+    __m128i block = _mm_loadu_si128((const __m128i *)(str + last));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    mask &= 0xffffu << (i - last);
+    return (mask != 0) ? last + __builtin_ctz(mask) : STRING_NOT_FOUND;
+}
+
+/// Compares the first and last byte of the needle against 16
+/// positions at once, and only calls `memcmp` on positions
+/// where both match.
+static size_t __find_sse2(const char *str, size_t n, const char *needle, size_t m) {
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i *)(str + i));
+        __m128i tail = _mm_loadu_si128((const __m128i *)(str + i + m - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask != 0) {
+            size_t j = i + __builtin_ctz(mask);
+            if (memcmp(str + j + 1, needle + 1, m - 2) == 0) return j;
+            mask &= mask - 1;
+        }
+    }
+
+    for (; i + m <= n; i++) {
+        if (str[i] == needle[0] && memcmp(str + i + 1, needle + 1, m - 1) == 0) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+static int __casecmp_sse2(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = __fold_sse2(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m128i y = __fold_sse2(_mm_loadu_si128((const __m128i *)(b + i)));
+        uint32_t diff = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffff;
+        if (diff != 0) {
+            size_t j = i + __builtin_ctz(diff);
+            return __fold(a[j]) - __fold(b[j]);
+        }
+    }
+    return __casecmp_scalar(a + i, b + i, len - i);
+}
+
+#endif // __SSE2__
+
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_AVX2 1
+
+// The AVX2 kernels are compiled for AVX2 no matter the
+// compiler flags, and only ever called if the CPU has it.
+// Only the block loops are AVX2 code: short strings and
+// tails go through the SSE2 kernels once the block loop has
+// returned, since running SSE2 code while the upper halves
+// of the AVX registers are in use is very slow on most CPUs.
+
+__attribute__((target("avx2")))
+static inline __m256i __fold_avx2(__m256i x) {
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(0x80 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_or_si256(x, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t __eq_mask_avx2(const char *a, const char *b) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)a);
+    __m256i y = _mm256_loadu_si256((const __m256i *)b);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+}
+
+/// Same as `__eq_sse2`, for at least 32 bytes.
+__attribute__((target("avx2")))
+static int __eq_avx2_blocks(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+    // Four blocks per iteration, so that long strings
+    // only take one branch every 128 bytes
+    for (; i + 128 <= len; i += 128) {
+        __m256i eq = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                  _mm256_loadu_si256((const __m256i *)(b + i))),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 32)),
+                                  _mm256_loadu_si256((const __m256i *)(b + i + 32)))),
+            _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 64)),
+                                  _mm256_loadu_si256((const __m256i *)(b + i + 64))),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i + 96)),
+                                  _mm256_loadu_si256((const __m256i *)(b + i + 96)))));
+        if ((uint32_t)_mm256_movemask_epi8(eq) != 0xffffffffu) return 0;
+    }
+    for (; i + 32 <= len; i += 32) {
+        if (__eq_mask_avx2(a + i, b + i) != 0xffffffffu) return 0;
+    }
+    return i == len || __eq_mask_avx2(a + len - 32, b + len - 32) == 0xffffffffu;
+}
+
+static int __eq_avx2(const char *a, const char *b, size_t len) {
+    return (len < 32) ? __eq_sse2(a, b, len) : __eq_avx2_blocks(a, b, len);
+}
+
+/// Same as `__find_byte_sse2`, for at least 32 bytes.
+__attribute__((target("avx2")))
+static size_t __find_byte_avx2_blocks(const char *str, size_t len, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i any = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(str + i)), needle),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(str + i + 32)), needle)),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(str + i + 64)), needle),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(str + i + 96)), needle)));
+        if (_mm256_movemask_epi8(any) != 0) break;
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(str + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    if (i == len) return STRING_NOT_FOUND;
+
+    size_t last = len - 32;
+    __m256i block = _mm256_loadu_si256((const __m256i *)(str + last));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+    mask &= 0xffffffffu << (i - last);
+    return (mask != 0) ? last + __builtin_ctz(mask) : STRING_NOT_FOUND;
+}
+
+static size_t __find_byte_avx2(const char *str, size_t len, char c) {
+    return (len < 32) ? __find_byte_sse2(str, len, c) : __find_byte_avx2_blocks(str, len, c);
+}
+
+/// Same as the block loop of `__find_sse2`. Stores
+/// where the loop stopped in `*done`.
+__attribute__((target("avx2")))
+static size_t __find_avx2_blocks(const char *str, size_t n, const char *needle, size_t m,
+                                 size_t *done) {
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i head = _mm256_loadu_si256((const __m256i *)(str + i));
+        __m256i tail = _mm256_loadu_si256((const __m256i *)(str + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        while (mask != 0) {
+            size_t j = i + __builtin_ctz(mask);
+            if (memcmp(str + j + 1, needle + 1, m - 2) == 0) return j;
+            mask &= mask - 1;
+        }
+    }
+
+    (*done) = i;
+    return STRING_NOT_FOUND;
+}
+
+static size_t __find_avx2(const char *str, size_t n, const char *needle, size_t m) {
+    size_t i = 0;
+    if (n >= m - 1 + 32) {
+        size_t found = __find_avx2_blocks(str, n, needle, m, &i);
+        if (found != STRING_NOT_FOUND) return found;
+    }
+
+    size_t found = __find_sse2(str + i, n - i, needle, m);
+    return (found != STRING_NOT_FOUND) ? i + found : STRING_NOT_FOUND;
+}
+
+/// Same as the block loop of `__casecmp_sse2`. Stores
+/// where the loop stopped in `*done`.
+__attribute__((target("avx2")))
+static int __casecmp_avx2_blocks(const char *a, const char *b, size_t len, size_t *done) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i eq = _mm256_and_si256(
+            _mm256_cmpeq_epi8(__fold_avx2(_mm256_loadu_si256((const __m256i *)(a + i))),
+                              __fold_avx2(_mm256_loadu_si256((const __m256i *)(b + i)))),
+            _mm256_cmpeq_epi8(__fold_avx2(_mm256_loadu_si256((const __m256i *)(a + i + 32))),
+                              __fold_avx2(_mm256_loadu_si256((const __m256i *)(b + i + 32)))));
+        if ((uint32_t)_mm256_movemask_epi8(eq) != 0xffffffffu) break;
+    }
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = __fold_avx2(_mm256_loadu_si256((const __m256i *)(a + i)));
+        __m256i y = __fold_avx2(_mm256_loadu_si256((const __m256i *)(b + i)));
+        uint32_t diff = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (diff != 0) {
+            size_t j = i + __builtin_ctz(diff);
+            return __fold(a[j]) - __fold(b[j]);
+        }
+    }
+
+    (*done) = i;
+    return 0;
+}
+
+static int __casecmp_avx2(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+    if (len >= 32) {
+        int diff = __casecmp_avx2_blocks(a, b, len, &i);
+        if (diff != 0) return diff;
+    }
+    return __casecmp_sse2(a + i, b + i, len - i);
+}
+
+#endif // STRING_AVX2
+
+/// The kernels behind the borrowed string operations,
+/// for the best instruction set that the CPU supports.
+typedef struct {
+    const char *isa;
+    int (*eq)(const char *a, const char *b, size_t len);
+    size_t (*find_byte)(const char *str, size_t len, char c);
+    size_t (*find)(const char *str, size_t n, const char *needle, size_t m);
+    int (*casecmp)(const char *a, const char *b, size_t len);
+} kernels_t;
+
+static const kernels_t scalar_kernels = {
+    "scalar", __eq_scalar, __find_byte_scalar, __find_scalar, __casecmp_scalar
+};
+
+#ifdef __SSE2__
+static const kernels_t sse2_kernels = {
+    "sse2", __eq_sse2, __find_byte_sse2, __find_sse2, __casecmp_sse2
+};
+#endif
+
+#ifdef STRING_AVX2
+static const kernels_t avx2_kernels = {
+    "avx2", __eq_avx2, __find_byte_avx2, __find_avx2, __casecmp_avx2
+};
+#endif
+
+static kernels_t kernels = {
+    "scalar", __eq_scalar, __find_byte_scalar, __find_scalar, __casecmp_scalar
+};
+
+/// Picks the kernels of `isa` ("avx2", "sse2" or "scalar").
+/// Returns 0 if this build or CPU can't run them. Only
+/// meant for tests, which check every set of kernels.
+int __string_use_isa(const char *isa) {
+#ifdef STRING_AVX2
+    if (strcmp(isa, "avx2") == 0) {
+        if (!__builtin_cpu_supports("avx2")) return 0;
+        kernels = avx2_kernels;
+        return 1;
+    }
+#endif
+#ifdef __SSE2__
+    if (strcmp(isa, "sse2") == 0) {
+        kernels = sse2_kernels;
+        return 1;
+    }
+#endif
+    if (strcmp(isa, "scalar") == 0) {
+        kernels = scalar_kernels;
+        return 1;
+    }
+    return 0;
+}
+
+/// Runs before `main`, so the kernels never change
+/// while other threads might be using them.
+__attribute__((constructor))
+static void __string_pick_kernels(void) {
+#ifdef STRING_AVX2
+    __builtin_cpu_init();
+#endif
+    if (!__string_use_isa("avx2")) {
+        (void)__string_use_isa("sse2");
+    }
+}
+
+const char *string_isa(void) {
+    return kernels.isa;
+}
+
+int string_eq(borrowed_string_t a, borrowed_string_t b) {
+    return a.len == b.len && kernels.eq(a.buf, b.buf, a.len);
+}
+
+int string_starts_with(borrowed_string_t str, borrowed_string_t prefix) {
+    return prefix.len <= str.len && kernels.eq(str.buf, prefix.buf, prefix.len);
+}
+
+size_t string_find_byte(borrowed_string_t str, char c) {
+    return kernels.find_byte(str.buf, str.len, c);
+}
+
+size_t string_find(borrowed_string_t str, borrowed_string_t needle) {
+    if (needle.len == 0) return 0;
+    if (needle.len > str.len) return STRING_NOT_FOUND;
+    if (needle.len == 1) return kernels.find_byte(str.buf, str.len, needle.buf[0]);
+
+    return kernels.find(str.buf, str.len, needle.buf, needle.len);
+}
+
+int string_split(borrowed_string_t *rest, char delim, borrowed_string_t *token) {
+    if (rest->buf == NULL) return 0;
+
+    size_t i = kernels.find_byte(rest->buf, rest->len, delim);
+    if (i == STRING_NOT_FOUND) {
+        // The last token, after which there is nothing left
+        (*token) = (*rest);
+        rest->buf = NULL;
+        rest->len = 0;
+        return 1;
+    }
+
+    token->buf = rest->buf;
+    token->len = i;
+    rest->buf += i + 1;
+    rest->len -= i + 1;
+    return 1;
+}
+
+int string_casecmp(borrowed_string_t a, borrowed_string_t b) {
+    size_t len = (a.len < b.len) ? a.len : b.len;
+    int diff = kernels.casecmp(a.buf, b.buf, len);
+    if (diff != 0) return diff;
+
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+int string_eq_nocase(borrowed_string_t a, borrowed_string_t b) {
+    return a.len == b.len && kernels.casecmp(a.buf, b.buf, a.len) == 0;
+}
@@ -0,0 +1,324 @@
+#include "strmap.h"
+#include "group.h"
+#include "hash.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// Key chunks start out this big and double up to KEY_CHUNK_MAX,
+/// unless a single key needs more.
+#define KEY_CHUNK_MIN 4096
+#define KEY_CHUNK_MAX (1024 * 1024)
+
+/// Bytes of removed keys the key chunks have to hold before they
+/// are compacted, so that small maps don't compact all the time.
+#define KEYS_COMPACT_MIN 4096
+
+/// A chunk of heap memory that the map's copies of its
+/// keys are bumped out of, linked to the chunk before it.
+typedef struct keychunk_t {
+    struct keychunk_t *next;
+    size_t used;
+    size_t cap;
+    char bytes[];
+} keychunk_t;
+
+/// A stored key along with its full hash. Comparing the hash
+/// (and length) first means that a tag collision almost never
+/// has to go through `memcmp`.
+typedef struct {
+    uint32_t hash;
+    size_t len;
+    const char *key;
+    void *val;
+} skv_t;
+
+struct strmap_t {
+    uint32_t seed;
+    size_t size;
+    size_t len;
+    size_t growth_left;
+    int8_t *ctrl;
+    skv_t *slots;
+
+    /// Holds the map's copies of its keys, newest chunk first.
+    /// Removed keys stay behind until the chunks are compacted.
+    keychunk_t *keys;
+    size_t live_key_bytes;
+    size_t dead_key_bytes;
+};
+
+static inline uint32_t __hash(const strmap_t *map, const void *key, size_t len) {
+    uint64_t hash = hash_bytes(key, len, map->seed);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/// Returns the index of the slot holding the key,
+/// or `map->len` if the key is not in the map.
+static size_t __strmap_find(const strmap_t *map, uint32_t hash, const void *key, size_t len) {
+    if (map->len == 0) return map->len;
+
+    size_t group_mask = map->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+    int8_t tag = (int8_t)(hash & 0x7f);
+
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        const int8_t *ctrl = map->ctrl + base;
+
+        bitmask_t candidates = __group_match(ctrl, tag);
+        while (candidates != 0) {
+            size_t i = base + __bitmask_next(&candidates);
+            const skv_t *pair = map->slots + i;
+            if (pair->hash == hash && pair->len == len && memcmp(pair->key, key, len) == 0) {
+                return i;
+            }
+        }
+
+        if (__group_match_empty(ctrl) != 0) {
+            return map->len;
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+/// Returns the index of the first empty or deleted slot along
+/// `hash`'s probe sequence.
+static size_t __strmap_find_insert_slot(const strmap_t *map, uint32_t hash) {
+    size_t group_mask = map->len / GROUP_WIDTH - 1;
+    size_t group = (hash >> 7) & group_mask;
+
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        bitmask_t free_slots = __group_match_empty_or_deleted(map->ctrl + base);
+        if (free_slots != 0) {
+            return base + __bitmask_next(&free_slots);
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+static inline void __strmap_set(strmap_t *map, size_t i, skv_t kv) {
+    if (map->ctrl[i] == CTRL_EMPTY) {
+        map->growth_left--;
+    }
+    map->ctrl[i] = (int8_t)(kv.hash & 0x7f);
+    map->slots[i] = kv;
+    map->size++;
+}
+
+/// Moves every pair into a new table. Doubles the table if the pairs
+/// fill more than half of it, otherwise it's mostly deleted slots,
+/// so the new table keeps the same length. Keys are not rehashed,
+/// since every slot carries its full hash.
+static void __strmap_grow(strmap_t *map) {
+    size_t new_len = GROUP_WIDTH;
+    if (map->len != 0) {
+        new_len = (map->size >= __group_capacity(map->len) / 2) ? map->len * 2 : map->len;
+    }
+
+    void *new_ptr = malloc((sizeof(skv_t) + sizeof(int8_t)) * new_len);
+    if (!new_ptr) {
+        __logln_err_fmt("Map couldn't be reallocated: %s", strerror(errno));
+        exit(1);
+    }
+
+    skv_t *old_slots = map->slots;
+    int8_t *old_ctrl = map->ctrl;
+    size_t old_len = map->len;
+
+    map->slots = new_ptr;
+    map->ctrl = (int8_t *)(map->slots + new_len);
+    map->len = new_len;
+    map->size = 0;
+    map->growth_left = __group_capacity(new_len);
+    (void)memset(map->ctrl, CTRL_EMPTY, new_len);
+
+    for (size_t i = 0; i < old_len; i++) {
+        if (old_ctrl[i] < 0) continue;
+        size_t index = __strmap_find_insert_slot(map, old_slots[i].hash);
+        __strmap_set(map, index, old_slots[i]);
+    }
+
+    free(old_slots);
+}
+
+static void __keys_free(keychunk_t *keys) {
+    while (keys != NULL) {
+        keychunk_t *next = keys->next;
+        free(keys);
+        keys = next;
+    }
+}
+
+/// Copies `len` bytes into the key chunks, starting a new chunk
+/// if the newest one is full, and returns where they were copied.
+static const char *__keys_copy(keychunk_t **keys, const void *key, size_t len) {
+    keychunk_t *chunk = *keys;
+    if (chunk == NULL || len > chunk->cap - chunk->used) {
+        size_t cap = (chunk == NULL) ? KEY_CHUNK_MIN : chunk->cap * 2;
+        if (cap > KEY_CHUNK_MAX) {
+            cap = KEY_CHUNK_MAX;
+        }
+        if (cap < len) {
+            cap = len;
+        }
+
+        chunk = malloc(sizeof(keychunk_t) + cap);
+        if (!chunk) {
+            __logln_err_fmt("Couldn't copy key into the map: %s", strerror(errno));
+            exit(1);
+        }
+        chunk->next = *keys;
+        chunk->used = 0;
+        chunk->cap = cap;
+        (*keys) = chunk;
+    }
+
+    char *copy = chunk->bytes + chunk->used;
+    (void)memcpy(copy, key, len);
+    chunk->used += len;
+    return copy;
+}
+
+/// Copies the live keys into fresh chunks and frees the old ones,
+/// along with every removed key in them. Only done once removed
+/// keys take up more memory than the live keys and the table
+/// together, so its cost is paid for by the removes before it.
+static void __strmap_compact_keys(strmap_t *map) {
+    size_t table_bytes = map->len * (sizeof(skv_t) + sizeof(int8_t));
+    if (map->dead_key_bytes < KEYS_COMPACT_MIN
+        || map->dead_key_bytes < map->live_key_bytes + table_bytes) {
+        return;
+    }
+
+    keychunk_t *keys = NULL;
+    for (size_t i = 0; i < map->len; i++) {
+        if (map->ctrl[i] < 0) continue;
+        skv_t *pair = map->slots + i;
+        pair->key = __keys_copy(&keys, pair->key, pair->len);
+    }
+
+    __keys_free(map->keys);
+    map->keys = keys;
+    map->dead_key_bytes = 0;
+}
+
+strmap_t *strmap_new(void) {
+    strmap_t *map = malloc(sizeof(strmap_t));
+    if (!map) {
+        __logln_err_fmt("Couldn't allocate new map: %s", strerror(errno));
+        exit(1);
+    }
+
+    (*map) = (strmap_t) {
+        .seed = time(0),
+        .size = 0,
+        .len = 0,
+        .growth_left = 0,
+        .ctrl = NULL,
+        .slots = NULL,
+        .keys = NULL,
+        .live_key_bytes = 0,
+        .dead_key_bytes = 0
+    };
+
+    return map;
+}
+
+void strmap_delete(strmap_t *map, void (*val_free)(void *val)) {
+    if (!map) return;
+
+    if (val_free != NULL) {
+        for (size_t i = 0; i < map->len; i++) {
+            if (map->ctrl[i] < 0) continue;
+            val_free(map->slots[i].val);
+        }
+    }
+
+    free(map->slots);
+    __keys_free(map->keys);
+    free(map);
+}
+
+void *strmap_get(strmap_t *map, const void *key, size_t len) {
+    if (!map) return NULL;
+
+    size_t i = __strmap_find(map, __hash(map, key, len), key, len);
+    if (i == map->len) return NULL;
+
+    return map->slots[i].val;
+}
+
+void *strmap_insert(strmap_t *map, const void *key, size_t len, void *val) {
+    if (!map) return NULL;
+
+    uint32_t hash = __hash(map, key, len);
+    size_t i = __strmap_find(map, hash, key, len);
+    if (i != map->len) {
+        void *old = map->slots[i].val;
+        map->slots[i].val = val;
+        return old;
+    }
+
+    if (map->len == 0) {
+        __strmap_grow(map);
+    }
+    i = __strmap_find_insert_slot(map, hash);
+    if (map->ctrl[i] == CTRL_EMPTY && map->growth_left == 0) {
+        __strmap_grow(map); // EXPENSIVE
+        i = __strmap_find_insert_slot(map, hash);
+    }
+
+    __strmap_compact_keys(map);
+    const char *copy = __keys_copy(&map->keys, key, len);
+    map->live_key_bytes += len;
+
+    __strmap_set(map, i, (skv_t) {
+        .hash = hash,
+        .len = len,
+        .key = copy,
+        .val = val
+    });
+    return NULL;
+}
+
+void *strmap_remove(strmap_t *map, const void *key, size_t len) {
+    if (!map) return NULL;
+
+    size_t i = __strmap_find(map, __hash(map, key, len), key, len);
+    if (i == map->len) return NULL;
+
+    size_t base = i & ~(size_t)(GROUP_WIDTH - 1);
+    if (__group_match_empty(map->ctrl + base) != 0) {
+        map->ctrl[i] = CTRL_EMPTY;
+        map->growth_left++;
+    } else {
+        map->ctrl[i] = CTRL_DELETED;
+    }
+    map->size--;
+    map->live_key_bytes -= len;
+    map->dead_key_bytes += len;
+
+    return map->slots[i].val;
+}
+
+void *strmap_get_str(strmap_t *map, borrowed_string_t key) {
+    return strmap_get(map, key.buf, key.len);
+}
+
+void *strmap_insert_str(strmap_t *map, borrowed_string_t key, void *val) {
+    return strmap_insert(map, key.buf, key.len, val);
+}
+
+void *strmap_remove_str(strmap_t *map, borrowed_string_t key) {
+    return strmap_remove(map, key.buf, key.len);
+}
+
+size_t strmap_len(strmap_t *map) {
+    return (map) ? map->size : 0;
+}
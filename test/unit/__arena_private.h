@@ -0,0 +1,8 @@
+#ifndef __ARENA_PRIVATE_H
+#define __ARENA_PRIVATE_H
+
+#include "../../include/arena.h"
+
+int global_is_empty(void);
+
+#endif // !__ARENA_PRIVATE_H
@@ -0,0 +1,8 @@
+#ifndef __STRING_PRIVATE_H
+#define __STRING_PRIVATE_H
+
+#include "../../include/string2.h"
+
+int __string_use_isa(const char *isa);
+
+#endif // !__STRING_PRIVATE_H
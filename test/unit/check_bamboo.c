@@ -1,6 +1,8 @@
-#include "../../include/arena.h"
+#include "__arena_private.h"
 
 #include <check.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 START_TEST(arena_allocates) {
@@ -20,6 +22,222 @@ START_TEST(big_alloc) {
 }
 END_TEST
 
+START_TEST(many_allocs_cross_commits) {
+    arena_set_commit_granularity(4096);
+    for (size_t i = 0; i < 1000; i++) {
+        uint8_t *block = arena_alloc(10000);
+        ck_assert_ptr_nonnull(block);
+        block[0] = 1;
+        block[9999] = 1;
+    }
+    arena_clear();
+}
+END_TEST
+
+START_TEST(independent_arenas) {
+    arena_t *long_lived = arena_new();
+    arena_t *short_lived = arena_new();
+    ck_assert_ptr_nonnull(long_lived);
+    ck_assert_ptr_nonnull(short_lived);
+
+    int64_t *kept = arena_alloc_in(long_lived, sizeof(int64_t));
+    *kept = 42;
+    for (size_t i = 0; i < 100; i++) {
+        int64_t *scratch = arena_alloc_in(short_lived, sizeof(int64_t));
+        ck_assert_ptr_nonnull(scratch);
+        *scratch = -1;
+        arena_clear_in(short_lived);
+    }
+    ck_assert_int_eq(*kept, 42);
+
+    arena_destroy(short_lived);
+    arena_destroy(long_lived);
+}
+END_TEST
+
+START_TEST(temp_arenas_nest) {
+    arena_t *arena = arena_new();
+    arena_temp_t *outer = arena_temp_new_in(arena);
+    arena_temp_t *inner = arena_temp_new_in(arena);
+    ck_assert_ptr_nonnull(arena_temp_alloc(inner, 64));
+    ck_assert_ptr_null(arena_alloc_in(arena, 8));
+
+    arena_temp_delete(inner);
+    ck_assert_ptr_null(arena_alloc_in(arena, 8));
+    inner = arena_temp_new_in(arena);
+    ck_assert_ptr_nonnull(arena_temp_alloc(inner, 64));
+
+    arena_temp_delete(outer);
+    ck_assert_ptr_nonnull(arena_alloc_in(arena, 8));
+    arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(aligned_allocs) {
+    arena_t *arena = arena_new();
+
+    uint8_t *a = arena_alloc_aligned_in(arena, 3, 1);
+    uint8_t *b = arena_alloc_aligned_in(arena, 3, 1);
+    ck_assert_ptr_eq(a + 3, b);
+
+    void *line = arena_alloc_aligned_in(arena, 64, 64);
+    ck_assert_uint_eq((uintptr_t)line % 64, 0);
+    void *page = arena_alloc_aligned_in(arena, 10, 4096);
+    ck_assert_uint_eq((uintptr_t)page % 4096, 0);
+
+    uint8_t *raw = arena_alloc_nozero_in(arena, 4096);
+    ck_assert_ptr_nonnull(raw);
+    raw[4095] = 0xff;
+
+    ck_assert_ptr_null(arena_alloc_aligned_in(arena, 8, 0));
+    ck_assert_ptr_null(arena_alloc_aligned_in(arena, 8, 24));
+    arena_temp_t *temp = arena_temp_new_in(arena);
+    ck_assert_ptr_null(arena_temp_alloc_aligned(temp, 8, 0));
+    arena_temp_delete(temp);
+
+    arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(allocator_grows_in_place) {
+    arena_t *arena = arena_new();
+    allocator alloc = arena_allocator(arena);
+
+    uint8_t *a = alloc.alloc(alloc.ctx, 16);
+    a[15] = 7;
+
+    // The latest allocation grows in place, even across commits
+    ck_assert_ptr_eq(alloc.realloc(alloc.ctx, a, 16, 1 << 20), a);
+    a[(1 << 20) - 1] = 9;
+
+    uint8_t *b = alloc.alloc(alloc.ctx, 16);
+    uint8_t *moved = alloc.realloc(alloc.ctx, a, 1 << 20, 2 << 20);
+    ck_assert_ptr_nonnull(moved);
+    ck_assert_ptr_ne(moved, a);
+    ck_assert_ptr_ne(moved, b);
+    ck_assert_uint_eq(moved[15], 7);
+    ck_assert_uint_eq(moved[(1 << 20) - 1], 9);
+
+    arena_temp_t *temp = arena_temp_new_in(arena);
+    ck_assert_ptr_null(alloc.alloc(alloc.ctx, 16));
+    ck_assert_ptr_null(alloc.realloc(alloc.ctx, moved, 2 << 20, 3 << 20));
+    arena_temp_delete(temp);
+
+    arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(stats_track_usage) {
+    arena_t *arena = arena_new();
+    arena_stats_t stats;
+
+    (void)arena_alloc_in(arena, 100);
+    (void)arena_alloc_in(arena, 3000);
+    int enabled = arena_stats_in(arena, &stats);
+    ck_assert_uint_ge(stats.offset, 3100);
+    ck_assert_uint_ge(stats.committed_bytes, stats.offset);
+
+    if (enabled) {
+        ck_assert_uint_eq(stats.num_allocs, 2);
+        ck_assert_uint_eq(stats.high_water, stats.offset);
+        ck_assert_uint_eq(stats.histogram[6], 1);
+        ck_assert_uint_eq(stats.histogram[11], 1);
+    }
+
+    size_t high_water = stats.offset;
+    arena_clear_in(arena);
+    (void)arena_stats_in(arena, &stats);
+    ck_assert_uint_eq(stats.offset, 0);
+    if (enabled) {
+        ck_assert_uint_eq(stats.high_water, high_water);
+    }
+
+    arena_stats_t total;
+    (void)arena_stats_global(&total);
+    ck_assert_uint_ge(total.committed_bytes, stats.committed_bytes);
+
+    arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(clear_releases_spikes) {
+    const size_t spike = 32 * 1024 * 1024;
+    arena_t *arena = arena_new();
+    arena_stats_t stats;
+    arena_set_retention_in(arena, ARENA_RELEASE_EAGER, 0);
+
+    // The cycle that spiked keeps its memory...
+    (void)arena_alloc_in(arena, spike);
+    arena_clear_in(arena);
+    (void)arena_stats_in(arena, &stats);
+    ck_assert_uint_ge(stats.committed_bytes, spike);
+
+    // ...but the next, quiet one gives it back
+    (void)arena_alloc_in(arena, 1024);
+    arena_clear_in(arena);
+    (void)arena_stats_in(arena, &stats);
+    ck_assert_uint_lt(stats.committed_bytes, spike / 2);
+
+    uint8_t *block = arena_alloc_in(arena, spike);
+    ck_assert_ptr_nonnull(block);
+    ck_assert_uint_eq(block[spike - 1], 0);
+
+    arena_temp_t *temp = arena_temp_new_in(arena);
+    (void)arena_temp_alloc(temp, spike);
+    arena_temp_delete(temp);
+    temp = arena_temp_new_in(arena);
+    arena_temp_delete(temp);
+    (void)arena_stats_in(arena, &stats);
+    ck_assert_uint_lt(stats.committed_bytes, spike * 2);
+
+    arena_destroy(arena);
+}
+END_TEST
+
+START_TEST(huge_page_arena) {
+    arena_t *arena = arena_new_with_flags(ARENA_HUGE_PAGES);
+    ck_assert_ptr_nonnull(arena);
+    ck_assert_uint_eq((uintptr_t)arena % (2 * 1024 * 1024), 0);
+
+    uint8_t *block = arena_alloc_in(arena, 5 * 1024 * 1024);
+    ck_assert_ptr_nonnull(block);
+    block[5 * 1024 * 1024 - 1] = 1;
+
+    arena_stats_t stats;
+    (void)arena_stats_in(arena, &stats);
+    ck_assert_uint_eq(stats.committed_bytes % (2 * 1024 * 1024), 0);
+
+    arena_destroy(arena);
+}
+END_TEST
+
+static void *alloc_and_exit(void *arg) {
+    int64_t *block = arena_alloc(sizeof(int64_t));
+    if (block == NULL) return NULL;
+    *block = (int64_t)(intptr_t)arg;
+    return block;
+}
+
+START_TEST(thread_arenas_die_with_threads) {
+    arena_delete();
+    ck_assert_int_eq(global_is_empty(), 1);
+
+    for (int round = 0; round < 4; round++) {
+        pthread_t threads[8];
+        for (int t = 0; t < 8; t++) {
+            ck_assert_int_eq(pthread_create(threads + t, NULL, alloc_and_exit,
+                                            (void *)(intptr_t)t), 0);
+        }
+        for (int t = 0; t < 8; t++) {
+            void *block;
+            pthread_join(threads[t], &block);
+            ck_assert_ptr_nonnull(block);
+        }
+        ck_assert_int_eq(global_is_empty(), 1);
+    }
+}
+END_TEST
+
 Suite *arena_suite(void) {
     Suite *s;
     TCase *tc_core;
@@ -30,6 +248,15 @@ Suite *arena_suite(void) {
 
     tcase_add_test(tc_core, arena_allocates);
     tcase_add_test(tc_core, big_alloc);
+    tcase_add_test(tc_core, many_allocs_cross_commits);
+    tcase_add_test(tc_core, independent_arenas);
+    tcase_add_test(tc_core, temp_arenas_nest);
+    tcase_add_test(tc_core, aligned_allocs);
+    tcase_add_test(tc_core, allocator_grows_in_place);
+    tcase_add_test(tc_core, stats_track_usage);
+    tcase_add_test(tc_core, clear_releases_spikes);
+    tcase_add_test(tc_core, huge_page_arena);
+    tcase_add_test(tc_core, thread_arenas_die_with_threads);
     suite_add_tcase(s, tc_core);
 
     return s;
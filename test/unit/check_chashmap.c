@@ -0,0 +1,183 @@
+#include "../../include/chashmap.h"
+
+#include <check.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+START_TEST(map_add_get_remove) {
+    chashmap_t *map = chashmap_new();
+    int a = 1, b = 2;
+
+    ck_assert_ptr_null(chashmap_insert(map, 5, &a));
+    ck_assert_ptr_eq(chashmap_get(map, 5), &a);
+    ck_assert_ptr_eq(chashmap_insert(map, 5, &b), &a);
+    ck_assert_ptr_eq(chashmap_get(map, 5), &b);
+    ck_assert_ptr_null(chashmap_insert(map, 0, &a));
+    ck_assert_uint_eq(chashmap_len(map), 2);
+
+    ck_assert_ptr_eq(chashmap_remove(map, 5), &b);
+    ck_assert_ptr_null(chashmap_get(map, 5));
+    ck_assert_ptr_eq(chashmap_remove(map, 0), &a);
+    ck_assert_uint_eq(chashmap_len(map), 0);
+
+    chashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_grows) {
+    chashmap_t *map = chashmap_new();
+
+    for (size_t i = 1; i <= 100000; i++) {
+        (void)chashmap_insert(map, i * 31, (void *)i);
+    }
+    for (size_t i = 1; i <= 100000; i++) {
+        ck_assert_ptr_eq(chashmap_get(map, i * 31), (void *)i);
+    }
+    ck_assert_uint_eq(chashmap_len(map), 100000);
+
+    chashmap_delete(map, NULL);
+}
+END_TEST
+
+/// More maps than a process has thread-specific keys.
+#define NUM_MAPS 2000
+
+START_TEST(map_many_live_maps) {
+    chashmap_t **maps = malloc(sizeof(chashmap_t *) * NUM_MAPS);
+    ck_assert_ptr_nonnull(maps);
+
+    for (size_t i = 0; i < NUM_MAPS; i++) {
+        maps[i] = chashmap_new();
+        ck_assert_ptr_null(chashmap_insert(maps[i], 7, (void *)(i + 1)));
+    }
+    for (size_t i = 0; i < NUM_MAPS; i++) {
+        ck_assert_ptr_eq(chashmap_get(maps[i], 7), (void *)(i + 1));
+        chashmap_delete(maps[i], NULL);
+    }
+    free(maps);
+}
+END_TEST
+
+START_TEST(map_remove_churn) {
+    chashmap_t *map = chashmap_new();
+
+    // Every round removes all of its keys, which rebuilds
+    // the table instead of leaving them all behind
+    for (size_t round = 0; round < 50; round++) {
+        size_t base = round * 1000 + 1;
+        for (size_t i = 0; i < 1000; i++) {
+            ck_assert_ptr_null(chashmap_insert(map, base + i, (void *)(base + i)));
+        }
+        ck_assert_ptr_eq(chashmap_get(map, base + 500), (void *)(base + 500));
+        for (size_t i = 0; i < 1000; i++) {
+            ck_assert_ptr_eq(chashmap_remove(map, base + i), (void *)(base + i));
+        }
+        ck_assert_uint_eq(chashmap_len(map), 0);
+        ck_assert_ptr_null(chashmap_get(map, base + 500));
+    }
+
+    ck_assert_ptr_null(chashmap_insert(map, 3, (void *)3));
+    ck_assert_ptr_eq(chashmap_get(map, 3), (void *)3);
+    chashmap_delete(map, NULL);
+}
+END_TEST
+
+#define NUM_WRITERS 2
+#define NUM_READERS 4
+#define KEYS_PER_WRITER 200000
+
+static chashmap_t *stress_map;
+static atomic_int writers_done;
+
+/// Values are always `key + 1`, so a reader can tell
+/// whether it ever saw a value that wasn't meant for the key.
+static void *stress_write(void *ctx) {
+    size_t base = (size_t)ctx * KEYS_PER_WRITER + 1;
+    for (size_t i = 0; i < KEYS_PER_WRITER; i++) {
+        size_t key = base + i;
+        (void)chashmap_insert(stress_map, key, (void *)(key + 1));
+        if (i % 3 == 0) {
+            if (chashmap_remove(stress_map, key) != (void *)(key + 1)) return (void *)1;
+        }
+    }
+    atomic_fetch_add(&writers_done, 1);
+    return NULL;
+}
+
+static void *stress_read(void *_unused) {
+    (void)_unused;
+    size_t x = 12345;
+    while (atomic_load(&writers_done) < NUM_WRITERS) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        size_t key = (x >> 33) % (NUM_WRITERS * KEYS_PER_WRITER) + 1;
+        void *val = chashmap_get(stress_map, key);
+        if (val != NULL && val != (void *)(key + 1)) return (void *)1;
+    }
+    return NULL;
+}
+
+START_TEST(map_concurrent_stress) {
+    pthread_t writers[NUM_WRITERS], readers[NUM_READERS];
+    stress_map = chashmap_new();
+    atomic_store(&writers_done, 0);
+
+    for (size_t i = 0; i < NUM_READERS; i++) {
+        ck_assert_int_eq(pthread_create(readers + i, NULL, stress_read, NULL), 0);
+    }
+    for (size_t i = 0; i < NUM_WRITERS; i++) {
+        ck_assert_int_eq(pthread_create(writers + i, NULL, stress_write, (void *)i), 0);
+    }
+
+    void *failed;
+    for (size_t i = 0; i < NUM_WRITERS; i++) {
+        pthread_join(writers[i], &failed);
+        ck_assert_ptr_null(failed);
+    }
+    for (size_t i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i], &failed);
+        ck_assert_ptr_null(failed);
+    }
+
+    for (size_t key = 1; key <= NUM_WRITERS * KEYS_PER_WRITER; key++) {
+        void *expected = ((key - 1) % KEYS_PER_WRITER % 3 == 0) ? NULL : (void *)(key + 1);
+        ck_assert_ptr_eq(chashmap_get(stress_map, key), expected);
+    }
+
+    chashmap_delete(stress_map, NULL);
+}
+END_TEST
+
+Suite *chashmap_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Concurrent Hashmap");
+
+    tc_core = tcase_create("Core");
+    tcase_set_timeout(tc_core, 60);
+
+    tcase_add_test(tc_core, map_add_get_remove);
+    tcase_add_test(tc_core, map_grows);
+    tcase_add_test(tc_core, map_many_live_maps);
+    tcase_add_test(tc_core, map_remove_churn);
+    tcase_add_test(tc_core, map_concurrent_stress);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int num_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = chashmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
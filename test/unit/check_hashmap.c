@@ -1,6 +1,9 @@
-#include "__hashmap_private.h"
+#include "../../include/hashmap.h"
+#include "../../include/arena.h"
+#include "../../include/hash.h"
 
 #include <check.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -12,10 +15,24 @@ START_TEST(new_hashmap_works) {
 END_TEST
 
 START_TEST(hash_works) {
-    size_t len = 10;
-    size_t seed = 0;
-    size_t index = __calc_index(seed, 25, len);
-    ck_assert(index < len);
+    // The map takes its tag from the low 7 bits of the hash and its
+    // first group from the bits above, so sequential keys have to
+    // spread over both
+    int groups[256] = {0}, tags[128] = {0};
+    size_t num_groups = 0, num_tags = 0;
+    for (uint64_t key = 0; key < 4096; key++) {
+        uint64_t hash = hash_u64(key, 0x5eed);
+        ck_assert_uint_eq(hash, hash_u64(key, 0x5eed));
+        ck_assert_uint_ne(hash, hash_u64(key, 0x5eee));
+
+        size_t group = (hash >> 7) & 255;
+        num_groups += !groups[group];
+        groups[group] = 1;
+        num_tags += !tags[hash & 0x7f];
+        tags[hash & 0x7f] = 1;
+    }
+    ck_assert_uint_eq(num_groups, 256);
+    ck_assert_uint_eq(num_tags, 128);
 }
 END_TEST
 
@@ -31,6 +48,342 @@ START_TEST(map_add_get) {
 }
 END_TEST
 
+START_TEST(map_insert_remove_many) {
+    hashmap_t *map = hashmap_new();
+
+    for (size_t i = 0; i < 10000; i++) {
+        ck_assert(hashmap_insert(map, i * 7919, (void *)(i + 1)));
+    }
+    for (size_t i = 0; i < 10000; i += 2) {
+        ck_assert_ptr_eq(hashmap_remove(map, i * 7919), (void *)(i + 1));
+    }
+    for (size_t i = 0; i < 10000; i++) {
+        void *expected = (i % 2 == 0) ? NULL : (void *)(i + 1);
+        ck_assert_ptr_eq(hashmap_get(map, i * 7919), expected);
+    }
+    for (size_t i = 1; i < 10000; i += 2) {
+        ck_assert_ptr_eq(hashmap_remove(map, i * 7919), (void *)(i + 1));
+    }
+    ck_assert(hashmap_is_empty(map));
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+static void __sum_keys(size_t key, void *val, void *ctx) {
+    (void)val;
+    *(size_t *)ctx += key;
+}
+
+START_TEST(map_for_each) {
+    hashmap_t *map = hashmap_new();
+    for (size_t i = 1; i <= 100; i++) {
+        (void)hashmap_insert(map, i, NULL);
+    }
+
+    size_t sum = 0;
+    hashmap_for_each(map, __sum_keys, &sum);
+    ck_assert_uint_eq(sum, 5050);
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_iter_order) {
+    hashmap_t *map = hashmap_new();
+    for (size_t i = 0; i < 100; i++) {
+        (void)hashmap_insert(map, i * 31, (void *)(i + 1));
+    }
+
+    size_t key;
+    void *val;
+    size_t n = 0;
+    hashmap_iter_t iter = hashmap_iter(map);
+    while (hashmap_iter_next(&iter, &key, &val)) {
+        ck_assert_uint_eq(key, n * 31);
+        ck_assert_ptr_eq(val, (void *)(n + 1));
+        n++;
+    }
+    ck_assert_uint_eq(n, 100);
+
+    // The last pair takes the removed pair's place
+    ck_assert_ptr_eq(hashmap_remove(map, 10 * 31), (void *)11);
+    ck_assert_uint_eq(hashmap_len(map), 99);
+    iter = hashmap_iter(map);
+    for (size_t i = 0; i <= 10; i++) {
+        ck_assert(hashmap_iter_next(&iter, &key, NULL));
+    }
+    ck_assert_uint_eq(key, 99 * 31);
+    ck_assert_ptr_eq(hashmap_get(map, 99 * 31), (void *)100);
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_entry_upsert) {
+    hashmap_t *map = hashmap_new();
+
+    int inserted;
+    void **slot = hashmap_entry(map, 7, &inserted);
+    ck_assert(inserted);
+    ck_assert_ptr_null(*slot);
+    (*slot) = (void *)1;
+
+    slot = hashmap_entry(map, 7, &inserted);
+    ck_assert(!inserted);
+    ck_assert_ptr_eq(*slot, (void *)1);
+
+    ck_assert_ptr_eq(hashmap_get_or_insert(map, 7, (void *)2), (void *)1);
+    ck_assert_ptr_eq(hashmap_get_or_insert(map, 8, (void *)2), (void *)2);
+
+    ck_assert_ptr_eq(hashmap_upsert(map, 7, (void *)3), (void *)1);
+    ck_assert_ptr_null(hashmap_upsert(map, 9, (void *)4));
+    ck_assert_ptr_eq(hashmap_get(map, 7), (void *)3);
+    ck_assert_ptr_eq(hashmap_get(map, 9), (void *)4);
+    ck_assert_uint_eq(hashmap_len(map), 3);
+
+    // Counting through the entry slot, across rehashes
+    for (size_t i = 0; i < 30000; i++) {
+        void **count = hashmap_entry(map, 100 + i % 1000, NULL);
+        (*count) = (void *)((uintptr_t)*count + 1);
+    }
+    ck_assert_uint_eq(hashmap_len(map), 1003);
+    for (size_t key = 100; key < 1100; key++) {
+        ck_assert_ptr_eq(hashmap_get(map, key), (void *)30);
+    }
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_get_many) {
+    const size_t count = 1000;
+    hashmap_t *map = hashmap_new();
+    for (size_t i = 0; i < count; i += 2) {
+        (void)hashmap_insert(map, i, (void *)(i + 1));
+    }
+
+    size_t keys[count];
+    void *vals[count];
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = count - 1 - i;
+    }
+
+    ck_assert_uint_eq(hashmap_get_many(map, keys, count, vals), count / 2);
+    for (size_t i = 0; i < count; i++) {
+        void *expected = (keys[i] % 2 == 0) ? (void *)(keys[i] + 1) : NULL;
+        ck_assert_ptr_eq(vals[i], expected);
+    }
+
+    // Batches that don't fill up
+    ck_assert_uint_eq(hashmap_get_many(map, keys + 1, 3, vals), 2);
+    ck_assert_ptr_eq(vals[0], (void *)(keys[1] + 1));
+    ck_assert_ptr_null(vals[1]);
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_reserve_and_bulk) {
+    const size_t count = 20000;
+    size_t *keys = malloc(sizeof(size_t) * count);
+    void **vals = malloc(sizeof(void *) * count);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = i * 7919;
+        vals[i] = (void *)(i + 1);
+    }
+
+    hashmap_t *map = hashmap_with_capacity(16);
+    ck_assert(hashmap_insert(map, 1, (void *)1));
+    hashmap_reserve(map, count);
+    ck_assert_ptr_eq(hashmap_get(map, 1), (void *)1);
+    ck_assert_ptr_eq(hashmap_remove(map, 1), (void *)1);
+
+    ck_assert(hashmap_insert_bulk(map, keys, vals, count / 2));
+    ck_assert(hashmap_insert_bulk(map, keys + count / 2, vals + count / 2, count - count / 2));
+    for (size_t i = 0; i < count; i++) {
+        ck_assert_ptr_eq(hashmap_get(map, keys[i]), vals[i]);
+    }
+    ck_assert_ptr_null(hashmap_get(map, 1));
+
+    hashmap_delete(map, NULL);
+    free(keys);
+    free(vals);
+}
+END_TEST
+
+START_TEST(map_incremental_rehash) {
+    const size_t count = 50000;
+    hashmap_config_t config = {.flags = HASHMAP_INCREMENTAL_REHASH};
+    hashmap_t *map = hashmap_new_with(&config);
+
+    for (size_t i = 0; i < count; i++) {
+        ck_assert(hashmap_insert(map, i * 7919, (void *)(i + 1)));
+
+        // Every pair stays visible while the tables are migrating
+        if (i % 97 == 0) {
+            for (size_t j = 0; j <= i; j += 13) {
+                ck_assert_ptr_eq(hashmap_get(map, j * 7919), (void *)(j + 1));
+            }
+        }
+    }
+
+    size_t sum = 0;
+    hashmap_for_each(map, __sum_keys, &sum);
+    ck_assert_uint_eq(sum, 7919 * (count - 1) * count / 2);
+
+    for (size_t i = 0; i < count; i += 2) {
+        ck_assert_ptr_eq(hashmap_remove(map, i * 7919), (void *)(i + 1));
+    }
+    for (size_t i = 0; i < count; i++) {
+        void *expected = (i % 2 == 0) ? NULL : (void *)(i + 1);
+        ck_assert_ptr_eq(hashmap_get(map, i * 7919), expected);
+    }
+    for (size_t i = 1; i < count; i += 2) {
+        ck_assert_ptr_eq(hashmap_remove(map, i * 7919), (void *)(i + 1));
+    }
+    ck_assert(hashmap_is_empty(map));
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+static uint64_t __constant_hash(size_t key, uint64_t seed) {
+    (void)key;
+    (void)seed;
+    return 0;
+}
+
+START_TEST(map_custom_hash) {
+    // Every key collides, so every lookup walks the probe sequence
+    hashmap_config_t config = {.hash = __constant_hash};
+    hashmap_t *map = hashmap_new_with(&config);
+
+    for (size_t i = 0; i < 500; i++) {
+        ck_assert(hashmap_insert(map, i, (void *)(i + 1)));
+    }
+    for (size_t i = 0; i < 500; i += 3) {
+        ck_assert_ptr_eq(hashmap_remove(map, i), (void *)(i + 1));
+    }
+    for (size_t i = 0; i < 500; i++) {
+        void *expected = (i % 3 == 0) ? NULL : (void *)(i + 1);
+        ck_assert_ptr_eq(hashmap_get(map, i), expected);
+    }
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_incremental_churn) {
+    const size_t count = 40000;
+    hashmap_config_t config = {.flags = HASHMAP_INCREMENTAL_REHASH};
+    hashmap_t *map = hashmap_new_with(&config);
+    char *present = calloc(count, 1);
+
+    // Removes land in both tables and both entry arrays while they
+    // migrate, moving pairs that haven't been copied over yet
+    for (size_t i = 0; i < count; i++) {
+        (void)hashmap_insert(map, i, (void *)(i + 1));
+        present[i] = 1;
+        if (i % 3 == 2) {
+            size_t victim = (i * 7) % (i + 1);
+            void *expected = present[victim] ? (void *)(victim + 1) : NULL;
+            ck_assert_ptr_eq(hashmap_remove(map, victim), expected);
+            present[victim] = 0;
+        }
+    }
+
+    size_t len = 0;
+    hashmap_iter_t iter = hashmap_iter(map);
+    size_t key;
+    void *val;
+    while (hashmap_iter_next(&iter, &key, &val)) {
+        ck_assert(present[key]);
+        ck_assert_ptr_eq(val, (void *)(key + 1));
+        len++;
+    }
+    ck_assert_uint_eq(len, hashmap_len(map));
+    for (size_t i = 0; i < count; i++) {
+        void *expected = present[i] ? (void *)(i + 1) : NULL;
+        ck_assert_ptr_eq(hashmap_get(map, i), expected);
+    }
+
+    free(present);
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_shrinks) {
+    const size_t count = 100000;
+    hashmap_t *map = hashmap_new();
+    for (size_t i = 0; i < count; i++) {
+        (void)hashmap_insert(map, i, (void *)(i + 1));
+    }
+    size_t peak = hashmap_memory_usage(map);
+
+    for (size_t i = 100; i < count; i++) {
+        ck_assert_ptr_eq(hashmap_remove(map, i), (void *)(i + 1));
+    }
+    ck_assert_uint_lt(hashmap_memory_usage(map), peak / 100);
+    for (size_t i = 0; i < 100; i++) {
+        ck_assert_ptr_eq(hashmap_get(map, i), (void *)(i + 1));
+    }
+
+    for (size_t i = 0; i < 100; i++) {
+        (void)hashmap_remove(map, i);
+    }
+    hashmap_shrink_to_fit(map);
+    hashmap_t *fresh = hashmap_new();
+    ck_assert_uint_eq(hashmap_memory_usage(map), hashmap_memory_usage(fresh));
+    hashmap_delete(fresh, NULL);
+    ck_assert(hashmap_insert(map, 5, (void *)6));
+    ck_assert_ptr_eq(hashmap_get(map, 5), (void *)6);
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_keeps_reservation) {
+    hashmap_t *map = hashmap_with_capacity(10000);
+    size_t reserved = hashmap_memory_usage(map);
+
+    for (size_t i = 0; i < 10000; i++) {
+        (void)hashmap_insert(map, i, (void *)(i + 1));
+    }
+    for (size_t i = 0; i < 10000; i++) {
+        (void)hashmap_remove(map, i);
+    }
+    ck_assert_uint_eq(hashmap_memory_usage(map), reserved);
+
+    hashmap_shrink_to_fit(map);
+    ck_assert_uint_lt(hashmap_memory_usage(map), reserved);
+
+    hashmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(map_arena_allocator) {
+    arena_t *arena = arena_new();
+    hashmap_config_t config = {.alloc = arena_allocator(arena)};
+
+    for (size_t round = 0; round < 3; round++) {
+        hashmap_t *map = hashmap_new_with(&config);
+        ck_assert_ptr_nonnull(map);
+        for (size_t i = 0; i < 5000; i++) {
+            (void)hashmap_insert(map, i, (void *)(i + 1));
+        }
+        for (size_t i = 0; i < 5000; i++) {
+            ck_assert_ptr_eq(hashmap_get(map, i), (void *)(i + 1));
+        }
+
+        // Dropped without hashmap_delete
+        arena_clear_in(arena);
+    }
+
+    arena_destroy(arena);
+}
+END_TEST
+
 static uint32_t __counter = 0;
 void __special_free(void *ptr) {
     __counter--;
@@ -64,6 +417,18 @@ Suite *hashmap_suite(void) {
     tcase_add_test(tc_core, new_hashmap_works);
     tcase_add_test(tc_core, hash_works);
     tcase_add_test(tc_core, map_add_get);
+    tcase_add_test(tc_core, map_insert_remove_many);
+    tcase_add_test(tc_core, map_for_each);
+    tcase_add_test(tc_core, map_iter_order);
+    tcase_add_test(tc_core, map_entry_upsert);
+    tcase_add_test(tc_core, map_get_many);
+    tcase_add_test(tc_core, map_reserve_and_bulk);
+    tcase_add_test(tc_core, map_incremental_rehash);
+    tcase_add_test(tc_core, map_incremental_churn);
+    tcase_add_test(tc_core, map_custom_hash);
+    tcase_add_test(tc_core, map_shrinks);
+    tcase_add_test(tc_core, map_keeps_reservation);
+    tcase_add_test(tc_core, map_arena_allocator);
     tcase_add_test(tc_core, map_delete_andfree);
     suite_add_tcase(s, tc_core);
 
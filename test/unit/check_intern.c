@@ -0,0 +1,193 @@
+#include "../../include/intern.h"
+
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static borrowed_string_t str_of(const char *s) {
+    return (borrowed_string_t) {.len = strlen(s), .buf = (char *)s};
+}
+
+START_TEST(intern_same_string_same_id) {
+    intern_t *in = intern_new(0);
+    ck_assert_ptr_nonnull(in);
+
+    char buf[] = "alpha";
+    uint32_t alpha = intern(in, str_of("alpha"));
+    uint32_t beta = intern(in, str_of("beta"));
+    ck_assert_uint_eq(alpha, 0);
+    ck_assert_uint_eq(beta, 1);
+    ck_assert_uint_eq(intern(in, str_of(buf)), alpha);
+    ck_assert_uint_eq(intern_find(in, str_of("beta")), beta);
+    ck_assert_uint_eq(intern_find(in, str_of("gamma")), INTERN_NONE);
+    ck_assert_uint_eq(intern_len(in), 2);
+
+    // The interner keeps its own copy
+    memset(buf, 'x', sizeof(buf) - 1);
+    borrowed_string_t found = intern_lookup(in, alpha);
+    ck_assert_uint_eq(found.len, 5);
+    ck_assert_str_eq(found.buf, "alpha");
+
+    intern_delete(in);
+}
+END_TEST
+
+START_TEST(intern_binary_and_empty) {
+    intern_t *in = intern_new(0);
+    const char bytes[] = {'a', '\0', 'b'};
+    borrowed_string_t binary = {.len = sizeof(bytes), .buf = (char *)bytes};
+
+    uint32_t empty = intern(in, str_of(""));
+    uint32_t bin = intern(in, binary);
+    ck_assert_uint_ne(empty, bin);
+    ck_assert_uint_ne(intern(in, str_of("a")), bin);
+
+    ck_assert_uint_eq(intern_lookup(in, empty).len, 0);
+    ck_assert_ptr_nonnull(intern_lookup(in, empty).buf);
+    ck_assert_int_eq(memcmp(intern_lookup(in, bin).buf, bytes, sizeof(bytes)), 0);
+
+    ck_assert_ptr_null(intern_lookup(in, 1000).buf);
+    ck_assert_ptr_null(intern_lookup(in, INTERN_NONE).buf);
+
+    intern_delete(in);
+}
+END_TEST
+
+START_TEST(intern_many) {
+    intern_t *in = intern_new(0);
+    const uint32_t n = 100000;
+    char buf[32];
+
+    for (uint32_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "ident_%u", i);
+        borrowed_string_t s = {.len = (size_t)len, .buf = buf};
+        ck_assert_uint_eq(intern(in, s), i);
+    }
+    ck_assert_uint_eq(intern_len(in), n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "ident_%u", i);
+        borrowed_string_t s = {.len = (size_t)len, .buf = buf};
+        ck_assert_uint_eq(intern(in, s), i);
+
+        borrowed_string_t found = intern_lookup(in, i);
+        ck_assert_uint_eq(found.len, (size_t)len);
+        ck_assert_str_eq(found.buf, buf);
+    }
+    ck_assert_uint_eq(intern_len(in), n);
+
+    intern_delete(in);
+}
+END_TEST
+
+#define NUM_INTERNERS 10000
+
+START_TEST(intern_many_live_interners) {
+    intern_t **interners = malloc(sizeof(intern_t *) * NUM_INTERNERS);
+    ck_assert_ptr_nonnull(interners);
+
+    for (size_t i = 0; i < NUM_INTERNERS; i++) {
+        interners[i] = intern_new(0);
+        ck_assert_ptr_nonnull(interners[i]);
+        ck_assert_uint_eq(intern(interners[i], (borrowed_string_t) {.len = 3, .buf = "key"}), 0);
+    }
+
+    // Longer than a whole string chunk
+    char *big = malloc(100000);
+    ck_assert_ptr_nonnull(big);
+    (void)memset(big, 'x', 100000);
+    borrowed_string_t s = {.len = 100000, .buf = big};
+    ck_assert_uint_eq(intern(interners[0], s), 1);
+    ck_assert_uint_eq(intern_find(interners[0], s), 1);
+    free(big);
+
+    for (size_t i = 0; i < NUM_INTERNERS; i++) {
+        borrowed_string_t found = intern_lookup(interners[i], 0);
+        ck_assert_str_eq(found.buf, "key");
+        intern_delete(interners[i]);
+    }
+    free(interners);
+}
+END_TEST
+
+#define NUM_THREADS 4
+#define NUM_SHARED 20000
+
+static intern_t *shared;
+static uint32_t seen[NUM_THREADS][NUM_SHARED];
+
+/// Every thread interns the same strings,
+/// each starting at a different one.
+static void *intern_shared(void *arg) {
+    size_t t = (size_t)arg;
+    char buf[32];
+    for (size_t j = 0; j < NUM_SHARED; j++) {
+        size_t i = (j + t * NUM_SHARED / NUM_THREADS) % NUM_SHARED;
+        int len = snprintf(buf, sizeof(buf), "shared_%zu", i);
+        borrowed_string_t s = {.len = (size_t)len, .buf = buf};
+        seen[t][i] = intern(shared, s);
+
+        borrowed_string_t found = intern_lookup(shared, seen[t][i]);
+        if (found.len != (size_t)len || memcmp(found.buf, buf, found.len) != 0) {
+            seen[t][i] = INTERN_NONE;
+        }
+    }
+    return NULL;
+}
+
+START_TEST(intern_thread_safe) {
+    shared = intern_new(INTERN_THREAD_SAFE);
+    pthread_t threads[NUM_THREADS];
+    for (size_t t = 0; t < NUM_THREADS; t++) {
+        ck_assert_int_eq(pthread_create(threads + t, NULL, intern_shared, (void *)t), 0);
+    }
+    for (size_t t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    ck_assert_uint_eq(intern_len(shared), NUM_SHARED);
+    for (size_t i = 0; i < NUM_SHARED; i++) {
+        ck_assert_uint_ne(seen[0][i], INTERN_NONE);
+        for (size_t t = 1; t < NUM_THREADS; t++) {
+            ck_assert_uint_eq(seen[t][i], seen[0][i]);
+        }
+    }
+
+    intern_delete(shared);
+}
+END_TEST
+
+Suite *intern_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Intern");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, intern_same_string_same_id);
+    tcase_add_test(tc_core, intern_binary_and_empty);
+    tcase_add_test(tc_core, intern_many);
+    tcase_add_test(tc_core, intern_many_live_interners);
+    tcase_add_test(tc_core, intern_thread_safe);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int num_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = intern_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,192 @@
+#include "../../include/pool.h"
+
+#include <check.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+START_TEST(pool_reuses_slots) {
+    pool_t *pool = pool_new(24, 0);
+    ck_assert_ptr_nonnull(pool);
+
+    void *a = pool_alloc(pool);
+    void *b = pool_alloc(pool);
+    ck_assert_ptr_nonnull(a);
+    ck_assert_ptr_nonnull(b);
+    ck_assert_ptr_ne(a, b);
+
+    pool_free(pool, a);
+    ck_assert_ptr_eq(pool_alloc(pool), a);
+
+    pool_delete(pool);
+}
+END_TEST
+
+START_TEST(pool_many_slots) {
+    const size_t count = 100000;
+    pool_t *pool = pool_new(sizeof(size_t), 0);
+    size_t **slots = malloc(sizeof(size_t *) * count);
+
+    for (size_t i = 0; i < count; i++) {
+        slots[i] = pool_alloc(pool);
+        ck_assert_ptr_nonnull(slots[i]);
+        ck_assert_uint_eq((uintptr_t)slots[i] % (2 * sizeof(void *)), 0);
+        *slots[i] = i;
+    }
+    for (size_t i = 0; i < count; i++) {
+        ck_assert_uint_eq(*slots[i], i);
+    }
+
+    free(slots);
+    pool_delete(pool);
+}
+END_TEST
+
+START_TEST(pool_allocator_vtable) {
+    pool_t *pool = pool_new(32, 0);
+    allocator alloc = pool_allocator(pool);
+
+    void *ptr = alloc.alloc(alloc.ctx, 32);
+    ck_assert_ptr_nonnull(ptr);
+    ck_assert_ptr_null(alloc.alloc(alloc.ctx, 33));
+    alloc.free(alloc.ctx, ptr);
+
+    pool_delete(pool);
+}
+END_TEST
+
+#define NUM_THREADS 4
+#define ROUNDS 20000
+
+static void *churn(void *ctx) {
+    pool_t *pool = ctx;
+    size_t *held[16];
+
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < 16; i++) {
+            held[i] = pool_alloc(pool);
+            if (held[i] == NULL) return (void *)1;
+            *held[i] = r;
+        }
+        for (size_t i = 0; i < 16; i++) {
+            if (*held[i] != r) return (void *)1;
+            pool_free(pool, held[i]);
+        }
+    }
+    return NULL;
+}
+
+START_TEST(pool_thread_cache) {
+    pool_t *pool = pool_new(sizeof(size_t), POOL_THREAD_CACHE);
+    pthread_t threads[NUM_THREADS];
+
+    for (size_t i = 0; i < NUM_THREADS; i++) {
+        ck_assert_int_eq(pthread_create(threads + i, NULL, churn, pool), 0);
+    }
+    for (size_t i = 0; i < NUM_THREADS; i++) {
+        void *failed;
+        pthread_join(threads[i], &failed);
+        ck_assert_ptr_null(failed);
+    }
+
+    pool_delete(pool);
+}
+END_TEST
+
+/// More pools than a process has thread-specific keys.
+#define NUM_POOLS 2000
+
+START_TEST(pool_many_live_pools) {
+    pool_t **pools = malloc(sizeof(pool_t *) * NUM_POOLS);
+    ck_assert_ptr_nonnull(pools);
+
+    for (size_t i = 0; i < NUM_POOLS; i++) {
+        pools[i] = pool_new(32, POOL_THREAD_CACHE);
+        ck_assert_ptr_nonnull(pools[i]);
+        size_t *slot = pool_alloc(pools[i]);
+        ck_assert_ptr_nonnull(slot);
+        *slot = i;
+        pool_free(pools[i], slot);
+    }
+    for (size_t i = 0; i < NUM_POOLS; i++) {
+        ck_assert_ptr_nonnull(pool_alloc(pools[i]));
+        pool_delete(pools[i]);
+    }
+    free(pools);
+}
+END_TEST
+
+static pool_t *shared;
+static pthread_barrier_t step;
+
+/// Caches a few slots of `shared`, then waits until the
+/// pool has been deleted before exiting.
+static void *cache_then_exit(void *_unused) {
+    (void)_unused;
+    void *slot = pool_alloc(shared);
+    pool_free(shared, slot);
+
+    pthread_barrier_wait(&step);
+    pthread_barrier_wait(&step);
+    return slot;
+}
+
+START_TEST(pool_deleted_before_thread_exits) {
+    shared = pool_new(sizeof(size_t), POOL_THREAD_CACHE);
+    pthread_barrier_init(&step, NULL, 2);
+
+    pthread_t thread;
+    ck_assert_int_eq(pthread_create(&thread, NULL, cache_then_exit, NULL), 0);
+    // Both threads cache slots of the pool before it's deleted
+    pool_free(shared, pool_alloc(shared));
+    pthread_barrier_wait(&step);
+    pool_delete(shared);
+    pthread_barrier_wait(&step);
+
+    void *slot;
+    pthread_join(thread, &slot);
+    ck_assert_ptr_nonnull(slot);
+    pthread_barrier_destroy(&step);
+
+    // A new pool doesn't pick up any of the old caches
+    pool_t *pool = pool_new(sizeof(size_t), POOL_THREAD_CACHE);
+    size_t *fresh = pool_alloc(pool);
+    ck_assert_ptr_nonnull(fresh);
+    *fresh = 1;
+    pool_free(pool, fresh);
+    pool_delete(pool);
+}
+END_TEST
+
+Suite *pool_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Pool");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, pool_reuses_slots);
+    tcase_add_test(tc_core, pool_many_slots);
+    tcase_add_test(tc_core, pool_allocator_vtable);
+    tcase_add_test(tc_core, pool_thread_cache);
+    tcase_add_test(tc_core, pool_many_live_pools);
+    tcase_add_test(tc_core, pool_deleted_before_thread_exits);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int num_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = pool_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
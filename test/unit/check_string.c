@@ -0,0 +1,344 @@
+#include "__string_private.h"
+#include "../../include/arena.h"
+
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+START_TEST(string_starts_empty) {
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc_with_cap(&str, 64), 1);
+    ck_assert_uint_eq(str.len, 0);
+    ck_assert_uint_ge(str.cap, 64);
+    ck_assert_str_eq(string_buf(&str), "");
+
+    borrowed_string_t view = string_view(&str);
+    ck_assert_uint_eq(view.len, 0);
+    ck_assert_ptr_eq(view.buf, string_buf(&str));
+
+    string_delete(&str);
+    ck_assert_uint_eq(str.len, 0);
+    ck_assert_int_eq(string_is_inline(&str), 1);
+    ck_assert_str_eq(string_buf(&str), "");
+}
+END_TEST
+
+START_TEST(string_appends) {
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc(&str), 1);
+
+    ck_assert_int_eq(string_append(&str, "hello", 5), 1);
+    ck_assert_int_eq(string_append(&str, ", ", 2), 1);
+    char world[] = "world";
+    borrowed_string_t other = {.len = 5, .buf = world};
+    ck_assert_int_eq(string_append_str(&str, other), 1);
+    ck_assert_int_eq(string_appendf(&str, " %d/%s", 42, "x"), 1);
+
+    ck_assert_uint_eq(str.len, strlen("hello, world 42/x"));
+    ck_assert_str_eq(string_buf(&str), "hello, world 42/x");
+
+    string_clear(&str);
+    ck_assert_uint_eq(str.len, 0);
+    ck_assert_str_eq(string_buf(&str), "");
+    ck_assert_int_eq(string_appendf(&str, "%s", ""), 1);
+    ck_assert_str_eq(string_buf(&str), "");
+
+    string_delete(&str);
+}
+END_TEST
+
+START_TEST(string_short_stays_inline) {
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc(&str), 1);
+    ck_assert_int_eq(string_is_inline(&str), 1);
+
+    char full[STRING_INLINE_CAP + 1];
+    memset(full, 'i', STRING_INLINE_CAP);
+    full[STRING_INLINE_CAP] = '\0';
+    ck_assert_int_eq(string_append(&str, full, STRING_INLINE_CAP), 1);
+    ck_assert_int_eq(string_is_inline(&str), 1);
+    ck_assert_ptr_eq(string_buf(&str), str.data.small);
+    ck_assert_str_eq(string_view(&str).buf, full);
+
+    // One more byte spills the string over to the heap
+    ck_assert_int_eq(string_appendf(&str, "%c", 'h'), 1);
+    ck_assert_int_eq(string_is_inline(&str), 0);
+    ck_assert_uint_eq(str.len, STRING_INLINE_CAP + 1);
+    ck_assert_int_eq(memcmp(string_buf(&str), full, STRING_INLINE_CAP), 0);
+    ck_assert_str_eq(string_buf(&str) + STRING_INLINE_CAP, "h");
+    string_delete(&str);
+
+    ck_assert_int_eq(string_alloc_with_cap(&str, STRING_INLINE_CAP), 1);
+    ck_assert_int_eq(string_is_inline(&str), 1);
+    ck_assert_int_eq(string_alloc_with_cap(&str, STRING_INLINE_CAP + 1), 1);
+    ck_assert_int_eq(string_is_inline(&str), 0);
+    string_delete(&str);
+}
+END_TEST
+
+START_TEST(string_zeroed_is_empty) {
+    owned_string_t str = {0};
+    ck_assert_int_eq(string_is_inline(&str), 1);
+    ck_assert_str_eq(string_buf(&str), "");
+
+    ck_assert_int_eq(string_append(&str, "abc", 3), 1);
+    ck_assert_str_eq(string_buf(&str), "abc");
+    ck_assert_int_eq(string_appendf(&str, "%s", "defghijklmnopqrstuvwxyz"), 1);
+    ck_assert_str_eq(string_buf(&str), "abcdefghijklmnopqrstuvwxyz");
+    string_delete(&str);
+
+    owned_string_t other = {0};
+    ck_assert_int_eq(string_reserve(&other, 100), 1);
+    ck_assert_uint_ge(other.cap, 100);
+    string_delete(&other);
+}
+END_TEST
+
+START_TEST(string_grows_geometrically) {
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc_with_cap(&str, 0), 1);
+
+    size_t reallocs = 0;
+    size_t cap = str.cap;
+    for (size_t i = 0; i < 100000; i++) {
+        ck_assert_int_eq(string_append(&str, "ab", 2), 1);
+        if (str.cap != cap) {
+            ck_assert_uint_ge(str.cap, 2 * cap);
+            cap = str.cap;
+            reallocs++;
+        }
+    }
+    ck_assert_uint_eq(str.len, 200000);
+    ck_assert_uint_lt(reallocs, 20);
+    ck_assert_int_eq(string_buf(&str)[str.len], '\0');
+    ck_assert_int_eq(memcmp(string_buf(&str) + 199998, "ab", 2), 0);
+
+    size_t before = str.cap;
+    ck_assert_int_eq(string_reserve(&str, before - str.len), 1);
+    ck_assert_uint_eq(str.cap, before);
+    ck_assert_int_eq(string_reserve(&str, SIZE_MAX), 0);
+    ck_assert_uint_eq(str.len, 200000);
+
+    string_delete(&str);
+}
+END_TEST
+
+START_TEST(string_appendf_grows) {
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc_with_cap(&str, 4), 1);
+    ck_assert_int_eq(string_append(&str, "ab", 2), 1);
+
+    char big[300];
+    memset(big, 'z', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    ck_assert_int_eq(string_appendf(&str, "[%s]", big), 1);
+
+    ck_assert_uint_eq(str.len, 2 + 2 + sizeof(big) - 1);
+    ck_assert_int_eq(string_buf(&str)[0], 'a');
+    ck_assert_int_eq(string_buf(&str)[2], '[');
+    ck_assert_int_eq(string_buf(&str)[str.len - 1], ']');
+    ck_assert_int_eq(string_buf(&str)[str.len], '\0');
+
+    string_delete(&str);
+}
+END_TEST
+
+START_TEST(string_in_arena) {
+    arena_t *arena = arena_new();
+    owned_string_t str;
+    ck_assert_int_eq(string_alloc_in(&str, arena, 8), 1);
+    ck_assert_int_eq(string_is_inline(&str), 0);
+
+    // As the arena's last allocation, the string
+    // grows without moving
+    char *first = string_buf(&str);
+    for (int i = 0; i < 1000; i++) {
+        ck_assert_int_eq(string_appendf(&str, "%04d,", i), 1);
+    }
+    ck_assert_ptr_eq(string_buf(&str), first);
+    ck_assert_uint_eq(str.len, 5000);
+    ck_assert_int_eq(memcmp(string_buf(&str) + 4995, "0999,", 5), 0);
+
+    // Once something else is allocated, it has to move
+    char *other = arena_alloc_in(arena, 16);
+    ck_assert_ptr_nonnull(other);
+    ck_assert_int_eq(string_reserve(&str, str.cap), 1);
+    ck_assert_ptr_ne(string_buf(&str), first);
+    ck_assert_int_eq(memcmp(string_buf(&str), "0000,0001,", 10), 0);
+    ck_assert_int_eq(memcmp(string_buf(&str) + 4995, "0999,", 5), 0);
+
+    string_delete(&str);
+    arena_destroy(arena);
+}
+END_TEST
+
+static borrowed_string_t str_of(const char *s) {
+    return (borrowed_string_t) {.len = strlen(s), .buf = (char *)s};
+}
+
+START_TEST(string_operations) {
+    ck_assert_int_eq(string_eq(str_of("abc"), str_of("abc")), 1);
+    ck_assert_int_eq(string_eq(str_of("abc"), str_of("abd")), 0);
+    ck_assert_int_eq(string_eq(str_of("abc"), str_of("ab")), 0);
+    ck_assert_int_eq(string_eq(str_of(""), str_of("")), 1);
+
+    ck_assert_int_eq(string_starts_with(str_of("content-type"), str_of("content-")), 1);
+    ck_assert_int_eq(string_starts_with(str_of("content"), str_of("content-")), 0);
+    ck_assert_int_eq(string_starts_with(str_of("abc"), str_of("")), 1);
+
+    ck_assert_uint_eq(string_find_byte(str_of("key=value"), '='), 3);
+    ck_assert_uint_eq(string_find_byte(str_of("key"), '='), STRING_NOT_FOUND);
+    ck_assert_uint_eq(string_find(str_of("GET /index.html HTTP/1.1"), str_of("HTTP")), 16);
+    ck_assert_uint_eq(string_find(str_of("aaab"), str_of("aab")), 1);
+    ck_assert_uint_eq(string_find(str_of("abc"), str_of("")), 0);
+    ck_assert_uint_eq(string_find(str_of("abc"), str_of("abcd")), STRING_NOT_FOUND);
+
+    ck_assert_int_eq(string_casecmp(str_of("Content-Type"), str_of("content-type")), 0);
+    ck_assert_int_lt(string_casecmp(str_of("apple"), str_of("Banana")), 0);
+    ck_assert_int_gt(string_casecmp(str_of("abc"), str_of("AB")), 0);
+    ck_assert_int_eq(string_eq_nocase(str_of("X-Request-ID"), str_of("x-request-id")), 1);
+    ck_assert_int_eq(string_eq_nocase(str_of("[@"), str_of("{`")), 0);
+
+    const char *expected[] = {"a", "", "b", ""};
+    borrowed_string_t rest = str_of("a,,b,"), token;
+    size_t n = 0;
+    while (string_split(&rest, ',', &token)) {
+        ck_assert_uint_lt(n, 4);
+        ck_assert_int_eq(string_eq(token, str_of(expected[n])), 1);
+        n++;
+    }
+    ck_assert_uint_eq(n, 4);
+
+    rest = str_of("");
+    ck_assert_int_eq(string_split(&rest, ',', &token), 1);
+    ck_assert_uint_eq(token.len, 0);
+    ck_assert_int_eq(string_split(&rest, ',', &token), 0);
+}
+END_TEST
+
+static size_t naive_find(const char *s, size_t n, const char *needle, size_t m) {
+    for (size_t i = 0; i + m <= n; i++) {
+        if (memcmp(s + i, needle, m) == 0) return i;
+    }
+    return STRING_NOT_FOUND;
+}
+
+static int naive_fold(char c) {
+    unsigned char u = (unsigned char)c;
+    return (u >= 'A' && u <= 'Z') ? u + 32 : u;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+/// Copies `len` bytes into a buffer of exactly that size,
+/// so that the sanitizers catch kernels reading past it.
+static borrowed_string_t exact_copy(const char *bytes, size_t len) {
+    char *buf = malloc((len > 0) ? len : 1);
+    memcpy(buf, bytes, len);
+    return (borrowed_string_t) {.len = len, .buf = buf};
+}
+
+START_TEST(string_kernels_match_naive) {
+    const char *isas[] = {"scalar", "sse2", "avx2"};
+    char hay[160], other[160];
+    uint32_t state = 12345;
+
+    for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        if (!__string_use_isa(isas[k])) continue;
+
+        for (size_t len = 0; len < sizeof(hay); len++) {
+            // A small alphabet, so that matches and near-matches are common
+            for (size_t i = 0; i < len; i++) {
+                state = state * 1103515245 + 12345;
+                hay[i] = "abAB[@{`"[(state >> 16) % 8];
+            }
+            memcpy(other, hay, len);
+            size_t flip = (len > 0) ? (state >> 8) % len : 0;
+            if (len > 0) other[flip] = (other[flip] == 'a') ? 'B' : 'a';
+
+            borrowed_string_t a = exact_copy(hay, len);
+            borrowed_string_t b = exact_copy(other, len);
+            borrowed_string_t same = exact_copy(hay, len);
+
+            ck_assert_int_eq(string_eq(a, same), 1);
+            ck_assert_int_eq(string_eq(a, b), len == 0 || memcmp(hay, other, len) == 0);
+
+            int expected = 0;
+            for (size_t i = 0; i < len && expected == 0; i++) {
+                expected = naive_fold(hay[i]) - naive_fold(other[i]);
+            }
+            ck_assert_int_eq(sign(string_casecmp(a, b)), sign(expected));
+            ck_assert_int_eq(string_eq_nocase(a, b), expected == 0);
+
+            const char *bytes = "abAB[@{`x";
+            for (size_t c = 0; bytes[c] != '\0'; c++) {
+                const char *found = (len > 0) ? memchr(hay, bytes[c], len) : NULL;
+                size_t want = (found != NULL) ? (size_t)(found - hay) : STRING_NOT_FOUND;
+                ck_assert_uint_eq(string_find_byte(a, bytes[c]), want);
+            }
+
+            for (size_t m = 0; m <= 5 && m <= len; m++) {
+                // A needle from the end of the string, which has
+                // to be found at or before where it came from
+                borrowed_string_t needle = exact_copy(hay + len - m, m);
+                ck_assert_uint_eq(string_find(a, needle), naive_find(hay, len, needle.buf, m));
+                if (m == 0) {
+                    free(needle.buf);
+                    continue;
+                }
+                needle.buf[0] = 'x';
+                ck_assert_uint_eq(string_find(a, needle), naive_find(hay, len, needle.buf, m));
+                free(needle.buf);
+            }
+
+            free(a.buf);
+            free(b.buf);
+            free(same.buf);
+        }
+    }
+
+    ck_assert_int_eq(__string_use_isa("scalar"), 1);
+    ck_assert_int_eq(__string_use_isa("mmx"), 0);
+    (void)(__string_use_isa("avx2") || __string_use_isa("sse2"));
+}
+END_TEST
+
+Suite *string_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("String");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, string_starts_empty);
+    tcase_add_test(tc_core, string_appends);
+    tcase_add_test(tc_core, string_short_stays_inline);
+    tcase_add_test(tc_core, string_zeroed_is_empty);
+    tcase_add_test(tc_core, string_grows_geometrically);
+    tcase_add_test(tc_core, string_appendf_grows);
+    tcase_add_test(tc_core, string_in_arena);
+    tcase_add_test(tc_core, string_operations);
+    tcase_add_test(tc_core, string_kernels_match_naive);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int num_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = string_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,198 @@
+#include "../../include/strmap.h"
+
+#include <check.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+START_TEST(strmap_insert_get) {
+    strmap_t *map = strmap_new();
+    ck_assert_ptr_nonnull(map);
+
+    ck_assert_ptr_null(strmap_insert(map, "alpha", 5, (void *)1));
+    ck_assert_ptr_null(strmap_insert(map, "beta", 4, (void *)2));
+    ck_assert_uint_eq(strmap_len(map), 2);
+
+    ck_assert_ptr_eq(strmap_get(map, "alpha", 5), (void *)1);
+    ck_assert_ptr_eq(strmap_get(map, "beta", 4), (void *)2);
+    ck_assert_ptr_null(strmap_get(map, "alph", 4));
+    ck_assert_ptr_null(strmap_get(map, "gamma", 5));
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(strmap_replaces_values) {
+    strmap_t *map = strmap_new();
+
+    ck_assert_ptr_null(strmap_insert(map, "key", 3, (void *)1));
+    ck_assert_ptr_eq(strmap_insert(map, "key", 3, (void *)2), (void *)1);
+    ck_assert_uint_eq(strmap_len(map), 1);
+    ck_assert_ptr_eq(strmap_get(map, "key", 3), (void *)2);
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(strmap_copies_keys) {
+    strmap_t *map = strmap_new();
+    char buf[] = "transient";
+
+    (void)strmap_insert(map, buf, sizeof(buf) - 1, (void *)1);
+    memset(buf, 'x', sizeof(buf) - 1);
+
+    ck_assert_ptr_eq(strmap_get(map, "transient", 9), (void *)1);
+    ck_assert_ptr_null(strmap_get(map, buf, sizeof(buf) - 1));
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(strmap_binary_and_string_keys) {
+    strmap_t *map = strmap_new();
+    const char bytes[] = {'a', '\0', 'b'};
+
+    (void)strmap_insert(map, bytes, sizeof(bytes), (void *)1);
+    (void)strmap_insert(map, "", 0, (void *)2);
+    ck_assert_ptr_eq(strmap_get(map, bytes, sizeof(bytes)), (void *)1);
+    ck_assert_ptr_null(strmap_get(map, "a", 1));
+    ck_assert_ptr_eq(strmap_get(map, "", 0), (void *)2);
+
+    borrowed_string_t name = {.len = 4, .buf = "name"};
+    ck_assert_ptr_null(strmap_insert_str(map, name, (void *)3));
+    ck_assert_ptr_eq(strmap_get_str(map, name), (void *)3);
+    ck_assert_ptr_eq(strmap_get(map, "name", 4), (void *)3);
+    ck_assert_ptr_eq(strmap_remove_str(map, name), (void *)3);
+    ck_assert_ptr_null(strmap_get_str(map, name));
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(strmap_insert_remove_many) {
+    const size_t count = 50000;
+    strmap_t *map = strmap_new();
+    char key[32];
+
+    for (size_t i = 0; i < count; i++) {
+        int len = snprintf(key, sizeof(key), "ident_%zu", i);
+        ck_assert_ptr_null(strmap_insert(map, key, len, (void *)(i + 1)));
+    }
+    ck_assert_uint_eq(strmap_len(map), count);
+
+    for (size_t i = 0; i < count; i += 2) {
+        int len = snprintf(key, sizeof(key), "ident_%zu", i);
+        ck_assert_ptr_eq(strmap_remove(map, key, len), (void *)(i + 1));
+    }
+    ck_assert_uint_eq(strmap_len(map), count / 2);
+
+    for (size_t i = 0; i < count; i++) {
+        int len = snprintf(key, sizeof(key), "ident_%zu", i);
+        void *expected = (i % 2 == 0) ? NULL : (void *)(i + 1);
+        ck_assert_ptr_eq(strmap_get(map, key, len), expected);
+    }
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+START_TEST(strmap_churn_reclaims_keys) {
+    strmap_t *map = strmap_new();
+    char key[64];
+    (void)strmap_insert(map, "kept", 4, (void *)1);
+    size_t before = mallinfo2().uordblks;
+
+    // 64 MB of keys go through the map, but only one
+    // of them is live at any time besides "kept"
+    for (size_t i = 0; i < 1000000; i++) {
+        memset(key, 'k', sizeof(key));
+        int len = snprintf(key, sizeof(key), "%zu", i);
+        key[len] = 'k';
+        ck_assert_ptr_null(strmap_insert(map, key, sizeof(key), (void *)(i + 2)));
+        ck_assert_ptr_eq(strmap_remove(map, key, sizeof(key)), (void *)(i + 2));
+    }
+    ck_assert_ptr_eq(strmap_get(map, "kept", 4), (void *)1);
+    ck_assert_uint_eq(strmap_len(map), 1);
+
+    ck_assert_uint_lt(mallinfo2().uordblks - before, 64 * 1024);
+
+    strmap_delete(map, NULL);
+}
+END_TEST
+
+/// Far more maps than fit into the address space
+/// if each of them reserved an arena.
+#define NUM_MAPS 10000
+
+START_TEST(strmap_many_live_maps) {
+    strmap_t **maps = malloc(sizeof(strmap_t *) * NUM_MAPS);
+    ck_assert_ptr_nonnull(maps);
+
+    for (size_t i = 0; i < NUM_MAPS; i++) {
+        maps[i] = strmap_new();
+        ck_assert_ptr_null(strmap_insert(maps[i], "key", 3, (void *)(i + 1)));
+    }
+    for (size_t i = 0; i < NUM_MAPS; i++) {
+        ck_assert_ptr_eq(strmap_get(maps[i], "key", 3), (void *)(i + 1));
+        strmap_delete(maps[i], NULL);
+    }
+    free(maps);
+}
+END_TEST
+
+static size_t freed = 0;
+
+static void count_free(void *val) {
+    (void)val;
+    freed++;
+}
+
+START_TEST(strmap_delete_frees_values) {
+    strmap_t *map = strmap_new();
+    (void)strmap_insert(map, "a", 1, (void *)1);
+    (void)strmap_insert(map, "b", 1, (void *)2);
+    (void)strmap_insert(map, "c", 1, (void *)3);
+    (void)strmap_remove(map, "b", 1);
+
+    freed = 0;
+    strmap_delete(map, count_free);
+    ck_assert_uint_eq(freed, 2);
+}
+END_TEST
+
+Suite *strmap_suite(void) {
+    Suite *s;
+    TCase *tc_core;
+
+    s = suite_create("Strmap");
+
+    tc_core = tcase_create("Core");
+
+    tcase_add_test(tc_core, strmap_insert_get);
+    tcase_add_test(tc_core, strmap_replaces_values);
+    tcase_add_test(tc_core, strmap_copies_keys);
+    tcase_add_test(tc_core, strmap_binary_and_string_keys);
+    tcase_add_test(tc_core, strmap_insert_remove_many);
+    tcase_add_test(tc_core, strmap_delete_frees_values);
+    tcase_add_test(tc_core, strmap_churn_reclaims_keys);
+    tcase_add_test(tc_core, strmap_many_live_maps);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+int main(void) {
+    int num_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = strmap_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    num_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (num_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}